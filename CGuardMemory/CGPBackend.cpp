@@ -0,0 +1,736 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPBackend.cpp  * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPBackend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#include <climits>
+#include <sys/uio.h>
+#endif
+
+#pragma mark - RegionFilter Implementation -
+
+bool _region_filter::Matches(const RegionInfo& region) const
+{
+    if ((region.protection & required_protection) != required_protection ||
+        (region.protection & forbidden_protection) != 0)
+    {
+        return false;
+    }
+
+    if ((sharing == CGPRegionSharing::Private && region.shared) ||
+        (sharing == CGPRegionSharing::Shared && !region.shared))
+    {
+        return false;
+    }
+
+    if ((backing == CGPRegionBacking::Anonymous && region.file_backed) ||
+        (backing == CGPRegionBacking::File && !region.file_backed))
+    {
+        return false;
+    }
+
+    if (region.size < min_size || region.size > max_size)
+    {
+        return false;
+    }
+
+    return tag < 0 || static_cast<int64_t>(region.tag) == tag;
+}
+
+_region_filter _region_filter::PrivateData()
+{
+    RegionFilter filter;
+    filter.required_protection = CGP_Prot_Read | CGP_Prot_Write;
+    filter.sharing = CGPRegionSharing::Private;
+    filter.backing = CGPRegionBacking::Anonymous;
+    return filter;
+}
+
+#pragma mark - CGPMemoryBackend Implementation -
+
+bool CGPMemoryBackend::Read(uint64_t address, void* buffer, size_t len) const
+{
+    RemoteIO op = { address, buffer, len, 0 };
+    return ReadBatch(&op, 1) == 1;
+}
+
+bool CGPMemoryBackend::Write(uint64_t address, const void* data, size_t len)
+{
+    RemoteIO op = { address, const_cast<void*>(data), len, 0 };
+    return WriteBatch(&op, 1) == 1;
+}
+
+bool CGPMemoryBackend::Identity(TargetIdentity& identity) const
+{
+    identity = { 0, 0 };
+    return false;
+}
+
+#if defined(__APPLE__)
+
+#pragma mark - CGPMachBackend Implementation -
+
+CGPMachBackend::CGPMachBackend(mach_port_t task)
+    : task_(task), pageSize_(static_cast<size_t>(sysconf(_SC_PAGESIZE))), lastStatus_(KERN_SUCCESS)
+{
+}
+
+/* Walks into submaps so shared cache and nested regions report their own info */
+static kern_return_t RecurseRegion(mach_port_t task, vm_address_t* address, RegionInfo& region)
+{
+    natural_t depth = 0;
+
+    for (;;)
+    {
+        vm_size_t vmsize = 0;
+        vm_region_submap_info_data_64_t info;
+        mach_msg_type_number_t count = VM_REGION_SUBMAP_INFO_COUNT_64;
+
+        kern_return_t kr = vm_region_recurse_64(task, address, &vmsize, &depth,
+                                                reinterpret_cast<vm_region_recurse_info_t>(&info), &count);
+        if (kr != KERN_SUCCESS)
+        {
+            return kr;
+        }
+
+        if (info.is_submap)
+        {
+            ++depth;
+            continue;
+        }
+
+        region.start = *address;
+        region.size = vmsize;
+        region.protection = info.protection;
+        region.max_protection = info.max_protection;
+        region.inheritance = info.inheritance;
+        region.tag = info.user_tag;
+        region.shared = (info.share_mode == SM_SHARED ||
+                         info.share_mode == SM_TRUESHARED ||
+                         info.share_mode == SM_SHARED_ALIASED);
+        region.file_backed = (info.external_pager != 0);
+        region.path.clear();
+
+        return KERN_SUCCESS;
+    }
+}
+
+bool CGPMachBackend::EnumerateRegions(const AddrRange& range, std::vector<RegionInfo>& regions) const
+{
+    regions.clear();
+
+    vm_address_t address = static_cast<vm_address_t>(range.start);
+
+    while (address < range.end)
+    {
+        RegionInfo region;
+
+        kern_return_t kr = RecurseRegion(task_, &address, region);
+        if (kr != KERN_SUCCESS)
+        { // KERN_INVALID_ADDRESS: no region at or above address
+            lastStatus_ = kr;
+            break;
+        }
+
+        if (address >= range.end)
+        {
+            break;
+        }
+
+        address += region.size;
+        regions.emplace_back(std::move(region));
+    }
+
+    return !regions.empty();
+}
+
+bool CGPMachBackend::QueryRegion(uint64_t address, RegionInfo& region) const
+{
+    vm_address_t addr = static_cast<vm_address_t>(address);
+
+    kern_return_t kr = RecurseRegion(task_, &addr, region);
+    if (kr != KERN_SUCCESS)
+    {
+        lastStatus_ = kr;
+        return false;
+    }
+
+    return true;
+}
+
+size_t CGPMachBackend::ReadBatch(RemoteIO* ops, size_t count) const
+{
+    size_t completed = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        vm_size_t bytesRead = 0;
+        kern_return_t kr = vm_read_overwrite(task_, static_cast<vm_address_t>(ops[i].address), ops[i].len,
+                                             reinterpret_cast<vm_address_t>(ops[i].buffer), &bytesRead);
+        if (kr != KERN_SUCCESS)
+        {
+            lastStatus_ = kr;
+            ops[i].transferred = 0;
+            continue;
+        }
+
+        ops[i].transferred = std::min(static_cast<size_t>(bytesRead), ops[i].len);
+
+        if (ops[i].transferred == ops[i].len)
+        {
+            ++completed;
+        }
+    }
+
+    return completed;
+}
+
+size_t CGPMachBackend::WriteBatch(RemoteIO* ops, size_t count)
+{
+    size_t completed = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        kern_return_t kr = vm_write(task_, static_cast<vm_address_t>(ops[i].address),
+                                    reinterpret_cast<vm_offset_t>(ops[i].buffer),
+                                    static_cast<mach_msg_type_number_t>(ops[i].len));
+        if (kr != KERN_SUCCESS)
+        {
+            lastStatus_ = kr;
+            ops[i].transferred = 0;
+            continue;
+        }
+
+        ops[i].transferred = ops[i].len;
+        ++completed;
+    }
+
+    return completed;
+}
+
+bool CGPMachBackend::Protect(uint64_t address, size_t size, int protection)
+{
+    kern_return_t kr = vm_protect(task_, static_cast<vm_address_t>(address), size, FALSE,
+                                  static_cast<vm_prot_t>(protection));
+    lastStatus_ = kr;
+    return kr == KERN_SUCCESS;
+}
+
+uint64_t CGPMachBackend::Allocate(size_t size)
+{
+    vm_address_t address = 0;
+    kern_return_t kr = vm_allocate(task_, &address, size, VM_FLAGS_ANYWHERE);
+    lastStatus_ = kr;
+    return (kr == KERN_SUCCESS) ? static_cast<uint64_t>(address) : 0;
+}
+
+bool CGPMachBackend::Deallocate(uint64_t address, size_t size)
+{
+    kern_return_t kr = vm_deallocate(task_, static_cast<vm_address_t>(address), size);
+    lastStatus_ = kr;
+    return kr == KERN_SUCCESS;
+}
+
+bool CGPMachBackend::Identity(TargetIdentity& identity) const
+{
+    identity = { 0, 0 };
+
+    int pid = 0;
+    kern_return_t kr = pid_for_task(task_, &pid);
+
+    if (kr != KERN_SUCCESS)
+    {
+        lastStatus_ = kr;
+        return false;
+    }
+
+    int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, pid };
+    struct kinfo_proc info;
+    size_t size = sizeof(info);
+
+    if (sysctl(mib, 4, &info, &size, nullptr, 0) != 0 || size == 0)
+    {
+        return false;
+    }
+
+    const struct timeval& start = info.kp_proc.p_starttime;
+
+    identity.pid = static_cast<uint64_t>(pid);
+    identity.start_time = static_cast<uint64_t>(start.tv_sec) * 1000000 + static_cast<uint64_t>(start.tv_usec);
+    return true;
+}
+
+#elif defined(__linux__)
+
+#pragma mark - CGPLinuxBackend Implementation -
+
+CGPLinuxBackend::CGPLinuxBackend(pid_t pid)
+    : pid_(pid), attached_(false), pageSize_(static_cast<size_t>(sysconf(_SC_PAGESIZE))), lastStatus_(0)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", static_cast<int>(pid_));
+
+    attached_ = (pid_ > 0 && access(path, R_OK) == 0);
+
+    if (!attached_)
+    {
+        lastStatus_ = errno;
+    }
+}
+
+static bool ParseMapsLine(char* line, RegionInfo& region)
+{
+    unsigned long long start = 0, end = 0, offset = 0, inode = 0;
+    unsigned int devMajor = 0, devMinor = 0;
+    char perms[8] = {};
+    int pathPos = 0;
+
+    if (sscanf(line, "%llx-%llx %7s %llx %x:%x %llu %n",
+               &start, &end, perms, &offset, &devMajor, &devMinor, &inode, &pathPos) < 7)
+    {
+        return false;
+    }
+
+    region.start = start;
+    region.size = end - start;
+    region.protection = (perms[0] == 'r' ? CGP_Prot_Read : 0) |
+                        (perms[1] == 'w' ? CGP_Prot_Write : 0) |
+                        (perms[2] == 'x' ? CGP_Prot_Execute : 0);
+    region.max_protection = region.protection;
+    region.inheritance = 0;
+    region.shared = (perms[3] == 's');
+    region.file_backed = (inode != 0);
+
+    char* path = line + pathPos;
+    size_t pathLen = strlen(path);
+
+    while (pathLen > 0 && (path[pathLen - 1] == '\n' || path[pathLen - 1] == ' '))
+    {
+        path[--pathLen] = '\0';
+    }
+
+    region.path.assign(path, pathLen);
+    return true;
+}
+
+bool CGPLinuxBackend::EnumerateRegions(const AddrRange& range, std::vector<RegionInfo>& regions) const
+{
+    regions.clear();
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", static_cast<int>(pid_));
+
+    FILE* maps = fopen(path, "r");
+
+    if (!maps)
+    {
+        lastStatus_ = errno;
+        return false;
+    }
+
+    char* line = nullptr;
+    size_t lineCap = 0;
+
+    while (getline(&line, &lineCap, maps) > 0)
+    {
+        RegionInfo region;
+
+        if (!ParseMapsLine(line, region))
+        {
+            continue;
+        }
+
+        if (region.start + region.size <= range.start)
+        {
+            continue;
+        }
+
+        if (region.start >= range.end)
+        {
+            break;
+        }
+
+        regions.emplace_back(std::move(region));
+    }
+
+    free(line);
+    fclose(maps);
+
+    return !regions.empty();
+}
+
+bool CGPLinuxBackend::QueryRegion(uint64_t address, RegionInfo& region) const
+{
+    std::vector<RegionInfo> regions;
+
+    if (!EnumerateRegions(AddrRange{address, UINT64_MAX}, regions))
+    {
+        return false;
+    }
+
+    region = std::move(regions.front());
+    return true;
+}
+
+size_t CGPLinuxBackend::TransferBatch(RemoteIO* ops, size_t count, bool write) const
+{
+    struct iovec local[IOV_MAX];
+    struct iovec remote[IOV_MAX];
+
+    size_t completed = 0;
+    size_t i = 0;
+
+    while (i < count)
+    {
+        size_t n = std::min(count - i, static_cast<size_t>(IOV_MAX));
+
+        for (size_t j = 0; j < n; ++j)
+        {
+            ops[i + j].transferred = 0;
+            local[j].iov_base = ops[i + j].buffer;
+            local[j].iov_len = ops[i + j].len;
+            remote[j].iov_base = reinterpret_cast<void*>(static_cast<uintptr_t>(ops[i + j].address));
+            remote[j].iov_len = ops[i + j].len;
+        }
+
+        ssize_t done = write ? process_vm_writev(pid_, local, n, remote, n, 0)
+                             : process_vm_readv(pid_, local, n, remote, n, 0);
+        if (done < 0)
+        {
+            lastStatus_ = errno;
+
+            if (errno != EFAULT)
+            { // ESRCH / EPERM: nothing else in the batch can succeed either
+                return completed;
+            }
+
+            ++i; // first op of the batch is unmapped, retry from the next one
+            continue;
+        }
+
+        // the kernel stops at the first remote iovec it cannot fully transfer
+        size_t remaining = static_cast<size_t>(done);
+        size_t j = 0;
+
+        for (; j < n; ++j)
+        {
+            if (remaining < ops[i + j].len)
+            {
+                ops[i + j].transferred = remaining;
+                break;
+            }
+
+            ops[i + j].transferred = ops[i + j].len;
+            remaining -= ops[i + j].len;
+            ++completed;
+        }
+
+        if (j < n)
+        {
+            lastStatus_ = EFAULT;
+            ++j;
+        }
+
+        i += j;
+    }
+
+    return completed;
+}
+
+size_t CGPLinuxBackend::ReadBatch(RemoteIO* ops, size_t count) const
+{
+    return TransferBatch(ops, count, false);
+}
+
+size_t CGPLinuxBackend::WriteBatch(RemoteIO* ops, size_t count)
+{
+    return TransferBatch(ops, count, true);
+}
+
+bool CGPLinuxBackend::Protect(uint64_t address, size_t size, int protection)
+{
+    if (pid_ != getpid())
+    {
+        lastStatus_ = EPERM;
+        return false;
+    }
+
+    uint64_t page = address & ~(static_cast<uint64_t>(pageSize_) - 1);
+
+    if (mprotect(reinterpret_cast<void*>(static_cast<uintptr_t>(page)), size + (address - page), protection) != 0)
+    {
+        lastStatus_ = errno;
+        return false;
+    }
+
+    return true;
+}
+
+uint64_t CGPLinuxBackend::Allocate(size_t size)
+{
+    if (pid_ != getpid())
+    {
+        lastStatus_ = EPERM;
+        return 0;
+    }
+
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (address == MAP_FAILED)
+    {
+        lastStatus_ = errno;
+        return 0;
+    }
+
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address));
+}
+
+bool CGPLinuxBackend::Deallocate(uint64_t address, size_t size)
+{
+    if (pid_ != getpid())
+    {
+        lastStatus_ = EPERM;
+        return false;
+    }
+
+    if (munmap(reinterpret_cast<void*>(static_cast<uintptr_t>(address)), size) != 0)
+    {
+        lastStatus_ = errno;
+        return false;
+    }
+
+    return true;
+}
+
+bool CGPLinuxBackend::Identity(TargetIdentity& identity) const
+{
+    identity = { 0, 0 };
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid_));
+
+    FILE* file = fopen(path, "r");
+
+    if (!file)
+    {
+        lastStatus_ = errno;
+        return false;
+    }
+
+    char line[1024];
+    bool read = fgets(line, sizeof(line), file) != nullptr;
+    fclose(file);
+
+    // comm may hold spaces and parentheses, fields restart after the last ')'
+    const char* field = read ? strrchr(line, ')') : nullptr;
+
+    if (!field)
+    {
+        return false;
+    }
+
+    // state is field 3, starttime field 22
+    for (int index = 2; index < 22 && field; ++index)
+    {
+        field = strchr(field + 1, ' ');
+    }
+
+    if (!field)
+    {
+        return false;
+    }
+
+    identity.pid = static_cast<uint64_t>(pid_);
+    identity.start_time = strtoull(field + 1, nullptr, 10);
+    return true;
+}
+
+#endif
+
+#pragma mark - CGPMachOBackend Implementation -
+
+CGPMachOBackend::CGPMachOBackend(std::shared_ptr<const CGPMachOFile> image)
+    : image_(std::move(image)), pageSize_(0x1000), lastStatus_(0)
+{
+    if (image_ && image_->CpuType() == CGP_MachO_CPU_ARM64)
+    {
+        pageSize_ = 0x4000;
+    }
+}
+
+static void SegmentRegion(const CGPMachOFile& image, const MachOSegment& segment, RegionInfo& region)
+{
+    region = RegionInfo();
+    region.start = segment.vmaddr;
+    region.size = segment.vmsize;
+    region.protection = segment.protection;
+    region.max_protection = segment.protection;
+    region.file_backed = true;
+    region.path = image.Path();
+}
+
+bool CGPMachOBackend::EnumerateRegions(const AddrRange& range, std::vector<RegionInfo>& regions) const
+{
+    regions.clear();
+
+    if (!IsAttached())
+    {
+        lastStatus_ = EBADF;
+        return false;
+    }
+
+    for (const MachOSegment& segment : image_->Segments())
+    {
+        // __PAGEZERO and other reservations hold nothing to read
+        if (segment.vmsize == 0 || segment.protection == CGP_Prot_None)
+        {
+            continue;
+        }
+
+        if (segment.vmaddr + segment.vmsize <= range.start || segment.vmaddr >= range.end)
+        {
+            continue;
+        }
+
+        RegionInfo region;
+        SegmentRegion(*image_, segment, region);
+        regions.emplace_back(std::move(region));
+    }
+
+    std::sort(regions.begin(), regions.end(), [](const RegionInfo& a, const RegionInfo& b)
+    {
+        return a.start < b.start;
+    });
+
+    return !regions.empty();
+}
+
+bool CGPMachOBackend::QueryRegion(uint64_t address, RegionInfo& region) const
+{
+    std::vector<RegionInfo> regions;
+
+    if (!EnumerateRegions(AddrRange{address, UINT64_MAX}, regions))
+    {
+        return false;
+    }
+
+    region = std::move(regions.front());
+    return true;
+}
+
+size_t CGPMachOBackend::ReadBatch(RemoteIO* ops, size_t count) const
+{
+    size_t completed = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        RemoteIO& op = ops[i];
+        op.transferred = 0;
+
+        if (!IsAttached())
+        {
+            continue;
+        }
+
+        // an op may run across adjacent segments
+        while (op.transferred < op.len)
+        {
+            uint64_t address = op.address + op.transferred;
+            const MachOSegment* found = nullptr;
+
+            for (const MachOSegment& segment : image_->Segments())
+            {
+                if (segment.protection != CGP_Prot_None && address >= segment.vmaddr && address - segment.vmaddr < segment.vmsize)
+                {
+                    found = &segment;
+                    break;
+                }
+            }
+
+            if (!found)
+            {
+                break;
+            }
+
+            uint64_t offset = address - found->vmaddr;
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(op.len - op.transferred, found->vmsize - offset));
+            uint8_t* out = static_cast<uint8_t*>(op.buffer) + op.transferred;
+
+            size_t fileChunk = 0;
+
+            if (offset < found->filesize)
+            {
+                fileChunk = static_cast<size_t>(std::min<uint64_t>(chunk, found->filesize - offset));
+                memcpy(out, image_->Translate(address, fileChunk), fileChunk);
+            }
+
+            memset(out + fileChunk, 0, chunk - fileChunk);
+            op.transferred += chunk;
+        }
+
+        if (op.transferred == op.len)
+        {
+            ++completed;
+        }
+        else
+        {
+            lastStatus_ = EFAULT;
+        }
+    }
+
+    return completed;
+}
+
+size_t CGPMachOBackend::WriteBatch(RemoteIO* ops, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        ops[i].transferred = 0;
+    }
+
+    lastStatus_ = EROFS;
+    return 0;
+}
+
+bool CGPMachOBackend::Protect(uint64_t address, size_t size, int protection)
+{
+    (void)address;
+    (void)size;
+    (void)protection;
+
+    lastStatus_ = EROFS;
+    return false;
+}
+
+uint64_t CGPMachOBackend::Allocate(size_t size)
+{
+    (void)size;
+
+    lastStatus_ = EROFS;
+    return 0;
+}
+
+bool CGPMachOBackend::Deallocate(uint64_t address, size_t size)
+{
+    (void)address;
+    (void)size;
+
+    lastStatus_ = EROFS;
+    return false;
+}
@@ -0,0 +1,227 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPBackend.h  * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPBackend_h
+#define CGPBackend_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CGPMachO.h"
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <sys/types.h>
+#endif
+
+/* Protection flags, same bit values as VM_PROT_* and PROT_* */
+#define CGP_Prot_None 0x0
+#define CGP_Prot_Read 0x1
+#define CGP_Prot_Write 0x2
+#define CGP_Prot_Execute 0x4
+
+typedef struct _addr_range {
+    uint64_t start;
+    uint64_t end;
+} AddrRange;
+
+typedef struct _region_info {
+    uint64_t start = 0;
+    uint64_t size = 0;
+    int protection = CGP_Prot_None;
+    int max_protection = CGP_Prot_None;
+    uint32_t inheritance = 0;
+    uint32_t tag = 0;          // Mach user_tag (VM_MEMORY_*), 0 on Linux
+    bool shared = false;
+    bool file_backed = false;
+    std::string path;          // Linux only
+} RegionInfo;
+
+enum class CGPRegionSharing {
+    Any,
+    Private,
+    Shared,
+};
+
+enum class CGPRegionBacking {
+    Any,
+    Anonymous,
+    File,
+};
+
+/* Prunes regions before anything is read from them */
+typedef struct _region_filter {
+    int required_protection = CGP_Prot_Read;
+    int forbidden_protection = CGP_Prot_None;
+    CGPRegionSharing sharing = CGPRegionSharing::Any;
+    CGPRegionBacking backing = CGPRegionBacking::Any;
+    uint64_t min_size = 0;
+    uint64_t max_size = UINT64_MAX;
+    int64_t tag = -1;          // -1 matches any tag
+
+    bool Matches(const RegionInfo& region) const;
+
+    /* Private, anonymous, read/write: where heap values live */
+    static _region_filter PrivateData();
+} RegionFilter;
+
+/*
+ * One remote transfer. `transferred` is filled by ReadBatch/WriteBatch,
+ * an op is complete only when transferred == len.
+ */
+typedef struct _remote_io {
+    uint64_t address;
+    void* buffer;
+    size_t len;
+    size_t transferred;
+} RemoteIO;
+
+/* Tells one run of a process from another, a reused pid has another start time */
+typedef struct _target_identity {
+    uint64_t pid;
+    uint64_t start_time;    // microseconds since the epoch on Mach, clock ticks since boot on Linux
+} TargetIdentity;
+
+/* Target Backend Interface */
+class CGPMemoryBackend {
+public:
+    virtual ~CGPMemoryBackend() = default;
+
+    virtual bool IsAttached() const = 0;
+    virtual size_t PageSize() const = 0;
+
+    /* Last native status: kern_return_t on Mach, errno on Linux */
+    virtual int LastStatus() const = 0;
+
+    /* Regions overlapping range, in ascending address order */
+    virtual bool EnumerateRegions(const AddrRange& range, std::vector<RegionInfo>& regions) const = 0;
+    /* Region containing address, or the first one above it */
+    virtual bool QueryRegion(uint64_t address, RegionInfo& region) const = 0;
+
+    /* Returns the number of ops that completed in full */
+    virtual size_t ReadBatch(RemoteIO* ops, size_t count) const = 0;
+    virtual size_t WriteBatch(RemoteIO* ops, size_t count) = 0;
+
+    bool Read(uint64_t address, void* buffer, size_t len) const;
+    bool Write(uint64_t address, const void* data, size_t len);
+
+    virtual bool Protect(uint64_t address, size_t size, int protection) = 0;
+    virtual uint64_t Allocate(size_t size) = 0;
+    virtual bool Deallocate(uint64_t address, size_t size) = 0;
+
+    /* false when the target is not a process */
+    virtual bool Identity(TargetIdentity& identity) const;
+};
+
+#if defined(__APPLE__)
+
+/* Mach Task Backend */
+class CGPMachBackend final : public CGPMemoryBackend {
+public:
+    explicit CGPMachBackend(mach_port_t task);
+
+    bool IsAttached() const override { return task_ != MACH_PORT_NULL; }
+    size_t PageSize() const override { return pageSize_; }
+    int LastStatus() const override { return lastStatus_; }
+
+    bool EnumerateRegions(const AddrRange& range, std::vector<RegionInfo>& regions) const override;
+    bool QueryRegion(uint64_t address, RegionInfo& region) const override;
+
+    size_t ReadBatch(RemoteIO* ops, size_t count) const override;
+    size_t WriteBatch(RemoteIO* ops, size_t count) override;
+
+    bool Protect(uint64_t address, size_t size, int protection) override;
+    uint64_t Allocate(size_t size) override;
+    bool Deallocate(uint64_t address, size_t size) override;
+    bool Identity(TargetIdentity& identity) const override;
+
+    mach_port_t Task() const { return task_; }
+
+private:
+    mach_port_t task_;
+    size_t pageSize_;
+    mutable std::atomic<kern_return_t> lastStatus_;
+};
+
+#elif defined(__linux__)
+
+/*
+ * Linux Process Backend
+ * Regions come from /proc/<pid>/maps, data moves through process_vm_readv
+ * and process_vm_writev with up to IOV_MAX ops per syscall.
+ */
+class CGPLinuxBackend final : public CGPMemoryBackend {
+public:
+    explicit CGPLinuxBackend(pid_t pid);
+
+    bool IsAttached() const override { return attached_; }
+    size_t PageSize() const override { return pageSize_; }
+    int LastStatus() const override { return lastStatus_; }
+
+    bool EnumerateRegions(const AddrRange& range, std::vector<RegionInfo>& regions) const override;
+    bool QueryRegion(uint64_t address, RegionInfo& region) const override;
+
+    size_t ReadBatch(RemoteIO* ops, size_t count) const override;
+    size_t WriteBatch(RemoteIO* ops, size_t count) override;
+
+    /* Protect/Allocate/Deallocate only work when pid is the calling process */
+    bool Protect(uint64_t address, size_t size, int protection) override;
+    uint64_t Allocate(size_t size) override;
+    bool Deallocate(uint64_t address, size_t size) override;
+    bool Identity(TargetIdentity& identity) const override;
+
+    pid_t Pid() const { return pid_; }
+
+private:
+    size_t TransferBatch(RemoteIO* ops, size_t count, bool write) const;
+
+    pid_t pid_;
+    bool attached_;
+    size_t pageSize_;
+    mutable std::atomic<int> lastStatus_;
+};
+
+#endif
+
+/*
+ * Mach-O File Backend
+ * Serves the segments of a mapped CGPMachOFile at their vmaddrs, the
+ * zero fill past a segment's file data reads as zeros. Read only.
+ */
+class CGPMachOBackend final : public CGPMemoryBackend {
+public:
+    explicit CGPMachOBackend(std::shared_ptr<const CGPMachOFile> image);
+
+    bool IsAttached() const override { return image_ && image_->IsOpen(); }
+    size_t PageSize() const override { return pageSize_; }
+    int LastStatus() const override { return lastStatus_; }
+
+    bool EnumerateRegions(const AddrRange& range, std::vector<RegionInfo>& regions) const override;
+    bool QueryRegion(uint64_t address, RegionInfo& region) const override;
+
+    size_t ReadBatch(RemoteIO* ops, size_t count) const override;
+    size_t WriteBatch(RemoteIO* ops, size_t count) override;
+
+    bool Protect(uint64_t address, size_t size, int protection) override;
+    uint64_t Allocate(size_t size) override;
+    bool Deallocate(uint64_t address, size_t size) override;
+
+    const CGPMachOFile* Image() const { return image_.get(); }
+
+private:
+    std::shared_ptr<const CGPMachOFile> image_;
+    size_t pageSize_;
+    mutable std::atomic<int> lastStatus_;
+};
+
+#endif /* CGPBackend_h */
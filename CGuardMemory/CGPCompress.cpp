@@ -0,0 +1,239 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPCompress.cpp * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPCompress.h"
+
+#include <cstring>
+
+#define CGP_LZ_Hash_Log 12
+#define CGP_LZ_Min_Match 4
+#define CGP_LZ_Last_Literals 5  // the block always ends with this many literals
+#define CGP_LZ_Match_Limit 12   // no match may start within this many bytes of the end
+#define CGP_LZ_Max_Offset 65535
+
+static inline uint32_t Read32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline bool WriteLength(uint8_t* dst, size_t* out, size_t capacity, size_t length)
+{
+    while (length >= 255)
+    {
+        if (*out >= capacity)
+        {
+            return false;
+        }
+
+        dst[(*out)++] = 255;
+        length -= 255;
+    }
+
+    if (*out >= capacity)
+    {
+        return false;
+    }
+
+    dst[(*out)++] = static_cast<uint8_t>(length);
+    return true;
+}
+
+/* matchLen == 0 writes the final literal-only sequence */
+static bool WriteSequence(uint8_t* dst, size_t* out, size_t capacity,
+                          const uint8_t* literals, size_t litLen, size_t offset, size_t matchLen)
+{
+    if (*out >= capacity)
+    {
+        return false;
+    }
+
+    uint8_t* token = dst + (*out)++;
+    *token = static_cast<uint8_t>((litLen >= 15 ? 15 : litLen) << 4);
+
+    if (litLen >= 15 && !WriteLength(dst, out, capacity, litLen - 15))
+    {
+        return false;
+    }
+
+    if (*out + litLen > capacity)
+    {
+        return false;
+    }
+
+    memcpy(dst + *out, literals, litLen);
+    *out += litLen;
+
+    if (matchLen == 0)
+    {
+        return true;
+    }
+
+    if (*out + 2 > capacity)
+    {
+        return false;
+    }
+
+    dst[(*out)++] = static_cast<uint8_t>(offset & 0xFF);
+    dst[(*out)++] = static_cast<uint8_t>(offset >> 8);
+
+    size_t extra = matchLen - CGP_LZ_Min_Match;
+    *token |= static_cast<uint8_t>(extra >= 15 ? 15 : extra);
+
+    return extra < 15 || WriteLength(dst, out, capacity, extra - 15);
+}
+
+size_t CGPCompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity)
+{
+    uint32_t table[1 << CGP_LZ_Hash_Log] = {};
+
+    size_t out = 0;
+    size_t anchor = 0;
+    size_t i = 0;
+
+    if (size > CGP_LZ_Match_Limit)
+    {
+        size_t limit = size - CGP_LZ_Match_Limit;
+
+        while (i < limit)
+        {
+            uint32_t sequence = Read32(src + i);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - CGP_LZ_Hash_Log);
+            size_t ref = table[hash];
+            table[hash] = static_cast<uint32_t>(i);
+
+            if (ref >= i || i - ref > CGP_LZ_Max_Offset || Read32(src + ref) != sequence)
+            {
+                ++i;
+                continue;
+            }
+
+            size_t matchLen = CGP_LZ_Min_Match;
+            size_t maxLen = size - CGP_LZ_Last_Literals - i;
+
+            while (matchLen < maxLen && src[ref + matchLen] == src[i + matchLen])
+            {
+                ++matchLen;
+            }
+
+            if (!WriteSequence(dst, &out, capacity, src + anchor, i - anchor, i - ref, matchLen))
+            {
+                return 0;
+            }
+
+            i += matchLen;
+            anchor = i;
+        }
+    }
+
+    if (!WriteSequence(dst, &out, capacity, src + anchor, size - anchor, 0, 0))
+    {
+        return 0;
+    }
+
+    return out;
+}
+
+bool CGPDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < size)
+    {
+        uint8_t token = src[in++];
+        size_t litLen = token >> 4;
+
+        if (litLen == 15)
+        {
+            uint8_t byte = 0;
+
+            do
+            {
+                if (in >= size)
+                {
+                    return false;
+                }
+
+                byte = src[in++];
+                litLen += byte;
+            } while (byte == 255);
+        }
+
+        if (in + litLen > size || out + litLen > dstSize)
+        {
+            return false;
+        }
+
+        memcpy(dst + out, src + in, litLen);
+        in += litLen;
+        out += litLen;
+
+        if (in == size)
+        {
+            break; // final literal-only sequence
+        }
+
+        if (in + 2 > size)
+        {
+            return false;
+        }
+
+        size_t offset = src[in] | (static_cast<size_t>(src[in + 1]) << 8);
+        in += 2;
+
+        if (offset == 0 || offset > out)
+        {
+            return false;
+        }
+
+        size_t matchLen = token & 15;
+
+        if (matchLen == 15)
+        {
+            uint8_t byte = 0;
+
+            do
+            {
+                if (in >= size)
+                {
+                    return false;
+                }
+
+                byte = src[in++];
+                matchLen += byte;
+            } while (byte == 255);
+        }
+
+        matchLen += CGP_LZ_Min_Match;
+
+        if (out + matchLen > dstSize)
+        {
+            return false;
+        }
+
+        const uint8_t* from = dst + out - offset;
+
+        if (offset >= matchLen)
+        {
+            memcpy(dst + out, from, matchLen);
+        }
+        else
+        { // overlapping copy repeats the last `offset` bytes
+            for (size_t k = 0; k < matchLen; ++k)
+            {
+                dst[out + k] = from[k];
+            }
+        }
+
+        out += matchLen;
+    }
+
+    return out == dstSize;
+}
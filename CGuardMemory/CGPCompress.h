@@ -0,0 +1,26 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPCompress.h * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPCompress_h
+#define CGPCompress_h
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * LZ4 block format codec, greedy single-probe hash matcher.
+ * Tuned for page sized inputs, offsets stay below 64 KB.
+ */
+
+/* Returns the compressed size, or 0 if the output would not fit in capacity */
+size_t CGPCompress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+
+/* Fails on malformed input or when the output is not exactly dstSize bytes */
+bool CGPDecompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize);
+
+#endif /* CGPCompress_h */
@@ -0,0 +1,327 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPFreezer.cpp  * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPFreezer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+#pragma mark - CGPFreezer Implementation -
+
+CGPFreezer::CGPFreezer(CGPMemoryBackend& backend)
+    : backend_(backend), pageSize_(backend.PageSize()), commands_(nullptr), nextId_(1), size_(0),
+      ticks_(0), reads_(0), writes_(0), skipped_(0), hasWritten_(false), stop_(false)
+{
+    thread_ = std::thread(&CGPFreezer::ThreadLoop, this);
+}
+
+CGPFreezer::~CGPFreezer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    wake_.notify_one();
+    thread_.join();
+
+    FreezeCommand* command = commands_.exchange(nullptr);
+
+    while (command)
+    {
+        FreezeCommand* next = command->next;
+        delete command;
+        command = next;
+    }
+}
+
+void CGPFreezer::Push(FreezeCommand* command)
+{
+    FreezeCommand* head = commands_.load(std::memory_order_relaxed);
+
+    do
+    {
+        command->next = head;
+    } while (!commands_.compare_exchange_weak(head, command, std::memory_order_release, std::memory_order_relaxed));
+
+    // a wakeup lost to the race with the wait only delays the command until the next pass
+    wake_.notify_one();
+}
+
+uint64_t CGPFreezer::Add(uint64_t address, const void* data, size_t len, uint32_t intervalMs)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    FreezeCommand* command = new FreezeCommand{ nullptr, Op::Add, nextId_.fetch_add(1), address, intervalMs,
+                                                std::vector<uint8_t>(bytes, bytes + len) };
+    uint64_t id = command->id;
+
+    Push(command);
+    return id;
+}
+
+void CGPFreezer::Remove(uint64_t id)
+{
+    Push(new FreezeCommand{ nullptr, Op::Remove, id, 0, 0, {} });
+}
+
+void CGPFreezer::Clear()
+{
+    Push(new FreezeCommand{ nullptr, Op::Clear, 0, 0, 0, {} });
+}
+
+FreezeStats CGPFreezer::Stats() const
+{
+    return { ticks_.load(), reads_.load(), writes_.load(), skipped_.load() };
+}
+
+void CGPFreezer::Drain()
+{
+    FreezeCommand* list = commands_.exchange(nullptr, std::memory_order_acquire);
+
+    if (!list)
+    {
+        return;
+    }
+
+    // the list is newest first
+    FreezeCommand* ordered = nullptr;
+
+    while (list)
+    {
+        FreezeCommand* next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    std::unordered_set<uint64_t> removed;
+    bool added = false;
+    Clock::time_point now = Clock::now();
+
+    while (ordered)
+    {
+        FreezeCommand* command = ordered;
+        ordered = command->next;
+
+        switch (command->op)
+        {
+            case Op::Add:
+                entries_.push_back({ command->id, command->address, std::chrono::milliseconds(command->interval), now,
+                                     std::move(command->value) });
+                added = true;
+                break;
+            case Op::Remove:
+                removed.insert(command->id);
+                break;
+            case Op::Clear:
+                entries_.clear();
+                removed.clear();
+                break;
+        }
+
+        delete command;
+    }
+
+    if (!removed.empty())
+    {
+        entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                      [&](const FreezeEntry& entry) { return removed.count(entry.id) != 0; }),
+                       entries_.end());
+    }
+
+    if (added)
+    {
+        std::stable_sort(entries_.begin(), entries_.end(),
+                         [](const FreezeEntry& a, const FreezeEntry& b) { return a.address < b.address; });
+    }
+
+    size_.store(entries_.size(), std::memory_order_relaxed);
+}
+
+void CGPFreezer::Pass(Clock::time_point now)
+{
+    due_.clear();
+
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        if (entries_[i].due <= now)
+        {
+            due_.push_back(i);
+        }
+    }
+
+    if (due_.empty())
+    {
+        return;
+    }
+
+    ++ticks_;
+
+    // due entries starting on one page and ending inside it share a group
+    uint64_t mask = ~static_cast<uint64_t>(pageSize_ - 1);
+    size_t staging = 0;
+
+    groups_.clear();
+
+    for (size_t i = 0; i < due_.size(); ++i)
+    {
+        const FreezeEntry& entry = entries_[due_[i]];
+        uint64_t end = entry.address + entry.value.size();
+
+        if (!groups_.empty() && (entry.address & mask) == (groups_.back().start & mask) &&
+            end <= (groups_.back().start & mask) + pageSize_)
+        {
+            FreezeGroup& group = groups_.back();
+
+            staging += (end > group.end) ? end - group.end : 0;
+            group.end = std::max(group.end, end);
+            group.last = i + 1;
+            continue;
+        }
+
+        groups_.push_back({ i, i + 1, entry.address, end, staging });
+        staging += entry.value.size();
+    }
+
+    staging_.resize(staging);
+    ops_.clear();
+
+    for (const auto& group : groups_)
+    {
+        ops_.push_back({ group.start, staging_.data() + group.staging, static_cast<size_t>(group.end - group.start), 0 });
+    }
+
+    backend_.ReadBatch(ops_.data(), ops_.size());
+    reads_ += ops_.size();
+
+    patches_.clear();
+
+    for (size_t g = 0; g < groups_.size(); ++g)
+    {
+        const FreezeGroup& group = groups_[g];
+        uint8_t* data = staging_.data() + group.staging;
+
+        if (ops_[g].transferred != ops_[g].len)
+        { // nothing to compare against, every value is written on its own
+            for (size_t i = group.first; i < group.last; ++i)
+            {
+                FreezeEntry& entry = entries_[due_[i]];
+                patches_.push_back({ entry.address, entry.value.data(), entry.value.size(), 0 });
+            }
+
+            continue;
+        }
+
+        // a patch only joins drifted values that touch or overlap, bytes between them are not ours to write
+        size_t first = patches_.size();
+
+        for (size_t i = group.first; i < group.last; ++i)
+        {
+            const FreezeEntry& entry = entries_[due_[i]];
+            uint8_t* at = data + (entry.address - group.start);
+            uint64_t end = entry.address + entry.value.size();
+
+            if (memcmp(at, entry.value.data(), entry.value.size()) == 0)
+            {
+                ++skipped_;
+                continue;
+            }
+
+            memcpy(at, entry.value.data(), entry.value.size());
+
+            if (patches_.size() > first && entry.address <= patches_.back().address + patches_.back().len)
+            {
+                RemoteIO& patch = patches_.back();
+                patch.len = std::max<size_t>(patch.len, static_cast<size_t>(end - patch.address));
+                continue;
+            }
+
+            patches_.push_back({ entry.address, at, entry.value.size(), 0 });
+        }
+    }
+
+    if (!patches_.empty())
+    {
+        backend_.WriteBatch(patches_.data(), patches_.size());
+        writes_ += patches_.size();
+
+        std::lock_guard<std::mutex> lock(writtenMutex_);
+
+        for (const auto& patch : patches_)
+        {
+            written_.push_back({ patch.address, patch.address + patch.len });
+        }
+
+        // nobody is taking them, one span covering everything is enough to invalidate
+        if (written_.size() > CGP_Freeze_Written_Max)
+        {
+            AddrRange span = written_[0];
+
+            for (const auto& range : written_)
+            {
+                span.start = std::min(span.start, range.start);
+                span.end = std::max(span.end, range.end);
+            }
+
+            written_.assign(1, span);
+        }
+
+        hasWritten_.store(true, std::memory_order_release);
+    }
+
+    for (size_t index : due_)
+    {
+        FreezeEntry& entry = entries_[index];
+        entry.due += entry.interval;
+
+        if (entry.due <= now)
+        { // fell behind, no burst of catch-up passes
+            entry.due = now + entry.interval;
+        }
+    }
+}
+
+bool CGPFreezer::TakeWritten(std::vector<AddrRange>& out)
+{
+    out.clear();
+
+    if (!hasWritten_.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(writtenMutex_);
+
+    out.swap(written_);
+    hasWritten_.store(false, std::memory_order_relaxed);
+
+    return !out.empty();
+}
+
+void CGPFreezer::ThreadLoop()
+{
+    while (!stop_.load())
+    {
+        Drain();
+
+        Clock::time_point now = Clock::now();
+        Pass(now);
+
+        Clock::time_point wake = now + std::chrono::milliseconds(CGP_Freeze_Idle_Ms);
+
+        for (const auto& entry : entries_)
+        {
+            wake = std::min(wake, entry.due);
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_until(lock, wake, [this] { return stop_.load() || commands_.load(std::memory_order_relaxed) != nullptr; });
+    }
+}
@@ -0,0 +1,134 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPFreezer.h  * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPFreezer_h
+#define CGPFreezer_h
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CGPBackend.h"
+
+/* Longest sleep of the freezer thread while nothing is due */
+#define CGP_Freeze_Idle_Ms 50
+
+/* Written ranges kept for TakeWritten() before they fold into one span */
+#define CGP_Freeze_Written_Max 1024
+
+typedef struct _freeze_stats {
+    uint64_t ticks;     // passes that had something due
+    uint64_t reads;     // read ops, one per page group
+    uint64_t writes;    // write ops, one per run of touching drifted values
+    uint64_t skipped;   // due values that still held their frozen bytes
+} FreezeStats;
+
+/*
+ * Value Freezer
+ * A background thread rewrites frozen values on their interval. Due values
+ * on one page are read in one op, only drifted values are written back, and
+ * every op of a pass goes through a single ReadBatch/WriteBatch.
+ * Add/Remove/Clear push onto a lock-free list drained by the thread, so
+ * they never wait on a pass in progress.
+ */
+class CGPFreezer {
+public:
+    /* backend outlives the freezer */
+    explicit CGPFreezer(CGPMemoryBackend& backend);
+    ~CGPFreezer();
+
+    CGPFreezer(const CGPFreezer&) = delete;
+    CGPFreezer& operator=(const CGPFreezer&) = delete;
+
+    /* Returns the entry id, never 0 */
+    uint64_t Add(uint64_t address, const void* data, size_t len, uint32_t intervalMs);
+    void Remove(uint64_t id);
+    void Clear();
+
+    /* Ranges written since the last call, false if none, for the caller to drop from caches of its own */
+    bool TakeWritten(std::vector<AddrRange>& out);
+
+    /* Entries as of the last pass */
+    size_t Size() const { return size_.load(std::memory_order_relaxed); }
+    FreezeStats Stats() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    enum class Op : uint8_t {
+        Add,
+        Remove,
+        Clear,
+    };
+
+    typedef struct _freeze_command {
+        _freeze_command* next;
+        Op op;
+        uint64_t id;
+        uint64_t address;
+        uint32_t interval;
+        std::vector<uint8_t> value;
+    } FreezeCommand;
+
+    typedef struct _freeze_entry {
+        uint64_t id;
+        uint64_t address;
+        Clock::duration interval;
+        Clock::time_point due;
+        std::vector<uint8_t> value;
+    } FreezeEntry;
+
+    typedef struct _freeze_group {
+        size_t first;       // due entries [first, last) in due_
+        size_t last;
+        uint64_t start;
+        uint64_t end;
+        size_t staging;     // offset of the group's bytes in staging_
+    } FreezeGroup;
+
+    void Push(FreezeCommand* command);
+    void Drain();
+    void Pass(Clock::time_point now);
+    void ThreadLoop();
+
+    CGPMemoryBackend& backend_;
+    size_t pageSize_;
+
+    std::atomic<FreezeCommand*> commands_;
+    std::atomic<uint64_t> nextId_;
+    std::atomic<size_t> size_;
+
+    // owned by the freezer thread
+    std::vector<FreezeEntry> entries_;  // by address
+    std::vector<size_t> due_;
+    std::vector<FreezeGroup> groups_;
+    std::vector<RemoteIO> ops_;
+    std::vector<RemoteIO> patches_;
+    std::vector<uint8_t> staging_;
+
+    std::atomic<uint64_t> ticks_;
+    std::atomic<uint64_t> reads_;
+    std::atomic<uint64_t> writes_;
+    std::atomic<uint64_t> skipped_;
+
+    std::mutex writtenMutex_;
+    std::vector<AddrRange> written_;
+    std::atomic<bool> hasWritten_;  // lets TakeWritten() skip the lock while nothing was written
+
+    std::mutex mutex_;              // only guards the sleep
+    std::condition_variable wake_;
+    std::atomic<bool> stop_;
+    std::thread thread_;
+};
+
+#endif /* CGPFreezer_h */
@@ -0,0 +1,283 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPMachO.cpp  * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPMachO.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CGP_MachO_Header_Size 32    // mach_header_64
+#define CGP_MachO_Segment_Size 72   // segment_command_64
+#define CGP_MachO_Fat_Arch_Size 20
+#define CGP_MachO_Fat_Arch_64_Size 32
+
+/* Thin images are little endian on every target this reads */
+template <typename T>
+static inline T ReadLE(const uint8_t* p)
+{
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+/* Fat headers are big endian */
+static inline uint64_t ReadBE(const uint8_t* p, size_t size)
+{
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        value = (value << 8) | p[i];
+    }
+
+    return value;
+}
+
+#pragma mark - CGPMachOFile Implementation -
+
+CGPMachOFile::CGPMachOFile(const std::string& path, int32_t cpuType)
+    : path_(path), map_(nullptr), mapSize_(0), slice_(nullptr), sliceSize_(0), cpuType_(0),
+      imageBase_(0), hasUUID_(false), uuid_()
+{
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 || info.st_size < CGP_MachO_Header_Size)
+    {
+        close(fd);
+        return;
+    }
+
+    mapSize_ = static_cast<size_t>(info.st_size);
+    map_ = mmap(nullptr, mapSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+
+    if (map_ == MAP_FAILED)
+    {
+        map_ = nullptr;
+        mapSize_ = 0;
+        return;
+    }
+
+    if (!SelectSlice(cpuType) || !ParseCommands())
+    {
+        slice_ = nullptr;
+        sliceSize_ = 0;
+        segments_.clear();
+    }
+}
+
+CGPMachOFile::~CGPMachOFile()
+{
+    if (map_)
+    {
+        munmap(map_, mapSize_);
+    }
+}
+
+bool CGPMachOFile::SelectSlice(int32_t cpuType)
+{
+    const uint8_t* file = static_cast<const uint8_t*>(map_);
+
+    if (ReadLE<uint32_t>(file) == CGP_MachO_Magic_64)
+    {
+        int32_t type = ReadLE<int32_t>(file + 4);
+
+        if (cpuType != 0 && type != cpuType)
+        {
+            return false;
+        }
+
+        slice_ = file;
+        sliceSize_ = mapSize_;
+        cpuType_ = type;
+        return true;
+    }
+
+    uint32_t magic = static_cast<uint32_t>(ReadBE(file, 4));
+
+    if (magic != CGP_MachO_Fat_Magic && magic != CGP_MachO_Fat_Magic_64)
+    {
+        return false;
+    }
+
+    bool wide = (magic == CGP_MachO_Fat_Magic_64);
+    size_t entrySize = wide ? CGP_MachO_Fat_Arch_64_Size : CGP_MachO_Fat_Arch_Size;
+    uint64_t count = ReadBE(file + 4, 4);
+
+    if (8 + count * entrySize > mapSize_)
+    {
+        return false;
+    }
+
+    int32_t wanted = (cpuType != 0) ? cpuType : CGP_MachO_CPU_ARM64;
+    const uint8_t* fallback = nullptr;
+    size_t fallbackSize = 0;
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        const uint8_t* entry = file + 8 + i * entrySize;
+
+        int32_t type = static_cast<int32_t>(ReadBE(entry, 4));
+        uint64_t offset = wide ? ReadBE(entry + 8, 8) : ReadBE(entry + 8, 4);
+        uint64_t size = wide ? ReadBE(entry + 16, 8) : ReadBE(entry + 12, 4);
+
+        if (offset > mapSize_ || size > mapSize_ - offset || size < CGP_MachO_Header_Size)
+        {
+            continue;
+        }
+
+        if (ReadLE<uint32_t>(file + offset) != CGP_MachO_Magic_64)
+        {
+            continue; // 32-bit slice
+        }
+
+        if (type == wanted)
+        {
+            slice_ = file + offset;
+            sliceSize_ = static_cast<size_t>(size);
+            cpuType_ = type;
+            return true;
+        }
+
+        if (!fallback)
+        {
+            fallback = file + offset;
+            fallbackSize = static_cast<size_t>(size);
+        }
+    }
+
+    if (cpuType != 0 || !fallback)
+    {
+        return false;
+    }
+
+    slice_ = fallback;
+    sliceSize_ = fallbackSize;
+    cpuType_ = ReadLE<int32_t>(fallback + 4);
+    return true;
+}
+
+bool CGPMachOFile::ParseCommands()
+{
+    uint32_t commands = ReadLE<uint32_t>(slice_ + 16);
+    uint32_t commandsSize = ReadLE<uint32_t>(slice_ + 20);
+
+    if (commandsSize > sliceSize_ - CGP_MachO_Header_Size)
+    {
+        return false;
+    }
+
+    const uint8_t* command = slice_ + CGP_MachO_Header_Size;
+    const uint8_t* end = command + commandsSize;
+
+    for (uint32_t i = 0; i < commands; ++i)
+    {
+        if (end - command < 8)
+        {
+            return false;
+        }
+
+        uint32_t cmd = ReadLE<uint32_t>(command);
+        uint32_t cmdSize = ReadLE<uint32_t>(command + 4);
+
+        if (cmdSize < 8 || cmdSize > static_cast<size_t>(end - command))
+        {
+            return false;
+        }
+
+        if (cmd == CGP_MachO_LC_Segment_64 && cmdSize >= CGP_MachO_Segment_Size)
+        {
+            MachOSegment segment;
+            segment.name.assign(reinterpret_cast<const char*>(command + 8), strnlen(reinterpret_cast<const char*>(command + 8), 16));
+            segment.vmaddr = ReadLE<uint64_t>(command + 24);
+            segment.vmsize = ReadLE<uint64_t>(command + 32);
+            segment.fileoff = ReadLE<uint64_t>(command + 40);
+            segment.filesize = ReadLE<uint64_t>(command + 48);
+            segment.protection = ReadLE<int32_t>(command + 60);
+
+            // a truncated file only keeps what it holds
+            if (segment.fileoff > sliceSize_)
+            {
+                segment.filesize = 0;
+            }
+            else if (segment.filesize > sliceSize_ - segment.fileoff)
+            {
+                segment.filesize = sliceSize_ - segment.fileoff;
+            }
+
+            if (segment.filesize > segment.vmsize)
+            {
+                segment.filesize = segment.vmsize;
+            }
+
+            if (segment.fileoff == 0 && segment.filesize != 0)
+            {
+                imageBase_ = segment.vmaddr;
+            }
+
+            segments_.push_back(segment);
+        }
+        else if (cmd == CGP_MachO_LC_UUID && cmdSize >= 8 + sizeof(uuid_))
+        {
+            memcpy(uuid_, command + 8, sizeof(uuid_));
+            hasUUID_ = true;
+        }
+
+        command += cmdSize;
+    }
+
+    return !segments_.empty();
+}
+
+const MachOSegment* CGPMachOFile::FindSegment(const std::string& name) const
+{
+    for (const MachOSegment& segment : segments_)
+    {
+        if (segment.name == name)
+        {
+            return &segment;
+        }
+    }
+
+    return nullptr;
+}
+
+bool CGPMachOFile::UUID(uint8_t uuid[16]) const
+{
+    if (!hasUUID_)
+    {
+        return false;
+    }
+
+    memcpy(uuid, uuid_, sizeof(uuid_));
+    return true;
+}
+
+const uint8_t* CGPMachOFile::Translate(uint64_t address, size_t len) const
+{
+    for (const MachOSegment& segment : segments_)
+    {
+        if (address >= segment.vmaddr && address - segment.vmaddr <= segment.filesize &&
+            len <= segment.filesize - (address - segment.vmaddr))
+        {
+            return slice_ + segment.fileoff + (address - segment.vmaddr);
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,83 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPMachO.h  * * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPMachO_h
+#define CGPMachO_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Mach-O constants, spelled out so files parse on hosts without <mach-o/loader.h> */
+#define CGP_MachO_Magic_64 0xFEEDFACFu
+#define CGP_MachO_Fat_Magic 0xCAFEBABEu     // big endian on disk
+#define CGP_MachO_Fat_Magic_64 0xCAFEBABFu
+#define CGP_MachO_LC_Segment_64 0x19u
+#define CGP_MachO_LC_UUID 0x1Bu
+#define CGP_MachO_CPU_ARM64 0x0100000C
+#define CGP_MachO_CPU_X86_64 0x01000007
+
+typedef struct _macho_segment {
+    std::string name;
+    uint64_t vmaddr;
+    uint64_t vmsize;
+    uint64_t fileoff;   // from the start of the slice
+    uint64_t filesize;
+    int protection;     // initprot, CGP_Prot_* bits
+} MachOSegment;
+
+/*
+ * Mapped Mach-O File
+ * Maps a thin or fat 64-bit Mach-O read-only and parses its load commands
+ * without dyld. Segment data is served straight from the mapping, so
+ * addresses are the file's own vmaddrs, unslid.
+ */
+class CGPMachOFile {
+public:
+    /* cpuType 0 picks the arm64 slice of a fat file, or its first 64-bit slice */
+    explicit CGPMachOFile(const std::string& path, int32_t cpuType = 0);
+    ~CGPMachOFile();
+
+    CGPMachOFile(const CGPMachOFile&) = delete;
+    CGPMachOFile& operator=(const CGPMachOFile&) = delete;
+
+    bool IsOpen() const { return slice_ != nullptr; }
+    const std::string& Path() const { return path_; }
+    int32_t CpuType() const { return cpuType_; }
+
+    const std::vector<MachOSegment>& Segments() const { return segments_; }
+    const MachOSegment* FindSegment(const std::string& name) const;
+
+    /* vmaddr of the segment that maps the header */
+    uint64_t ImageBase() const { return imageBase_; }
+    /* false when the image has no LC_UUID */
+    bool UUID(uint8_t uuid[16]) const;
+
+    /* File data for [address, address + len), nullptr unless it lies in one segment's file range */
+    const uint8_t* Translate(uint64_t address, size_t len) const;
+
+private:
+    bool SelectSlice(int32_t cpuType);
+    bool ParseCommands();
+
+    std::string path_;
+    void* map_;
+    size_t mapSize_;
+
+    const uint8_t* slice_;
+    size_t sliceSize_;
+    int32_t cpuType_;
+
+    std::vector<MachOSegment> segments_;
+    uint64_t imageBase_;
+    bool hasUUID_;
+    uint8_t uuid_[16];
+};
+
+#endif /* CGPMachO_h */
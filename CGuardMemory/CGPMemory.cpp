@@ -10,13 +10,35 @@
 
 #pragma mark - CGPMemoryEngine Implementation -
 
+#if defined(__APPLE__)
 CGPMemoryEngine::CGPMemoryEngine(mach_port_t task)
-    : task_(task), result_(AllocateResult()), pageSize_(static_cast<size_t>(sysconf(_SC_PAGESIZE)))
+    : CGPMemoryEngine(std::make_unique<CGPMachBackend>(task))
 {
-    if (!result_) {
+}
+#elif defined(__linux__)
+CGPMemoryEngine::CGPMemoryEngine(pid_t pid)
+    : CGPMemoryEngine(std::make_unique<CGPLinuxBackend>(pid))
+{
+}
+#endif
+
+CGPMemoryEngine::CGPMemoryEngine(std::unique_ptr<CGPMemoryBackend> backend)
+    : backend_(std::move(backend)), result_(AllocateResult()), pageSize_(static_cast<size_t>(sysconf(_SC_PAGESIZE))),
+      scanThreads_(0), scanChunkSize_(CGP_Scan_Chunk_Size), scanAlignment_(0), snapshotAll_(false)
+{
+    if (!backend_ || !backend_->IsAttached())
+    {
+        SetError(CGPErrorCode::Invalid_State, "backend_ : CGPMemoryEngine");
+        return;
+    }
+
+    if (!result_)
+    {
         SetError(CGPErrorCode::Allocation_Fail, "result_ : CGPMemoryEngine");
-        task_ = MACH_PORT_NULL;
+        return;
     }
+
+    pageSize_ = backend_->PageSize();
 }
 
 CGPMemoryEngine::~CGPMemoryEngine()
@@ -34,601 +56,2992 @@ std::unique_ptr<Result> CGPMemoryEngine::AllocateResult()
     return std::make_unique<Result>();
 }
 
-void CGPMemoryEngine::ScanMemory(const AddrRange& range, const void* target, size_t len)
+typedef struct _scan_chunk {
+    uint64_t address;
+    size_t size;      // bytes a hit may start in
+    size_t readSize;  // size plus len - 1 bytes of the next chunk
+} ScanChunk;
+
+typedef struct _scan_task {
+    size_t first;     // chunk index range
+    size_t last;
+    size_t bytes;
+} ScanTask;
+
+typedef struct _scan_lane {
+    std::unique_ptr<uint8_t[]> buffer; // chunk size + len - 1, reused by every task of the lane
+    std::vector<RemoteIO> ops;
+    std::vector<size_t> hits;
+    std::vector<uint8_t> page;         // decompressed snapshot page
+
+    /* not value-initialized, every byte used comes from a read */
+    uint8_t* Buffer(size_t size)
+    {
+        if (!buffer)
+        {
+            buffer.reset(new (std::nothrow) uint8_t[size]);
+        }
+
+        return buffer.get();
+    }
+} ScanLane;
+
+/*
+ * Regions above chunkSize are cut into chunks that overlap by len - 1 bytes,
+ * consecutive small regions are packed into one task and read in one batch.
+ * Tasks come out in address order and never need more than chunkSize + len - 1 bytes.
+ */
+static void PlanScan(const std::vector<RegionInfo>& regions, const AddrRange& range, size_t len, size_t chunkSize,
+                     std::vector<ScanChunk>& chunks, std::vector<ScanTask>& tasks)
 {
-    if (!IsValid())
+    for (const auto& region : regions)
     {
-        return;
+        uint64_t start = std::max(region.start, range.start);
+        uint64_t end = std::min(region.start + region.size, range.end);
+
+        for (uint64_t at = start; at + len <= end; at += chunkSize)
+        {
+            size_t size = static_cast<size_t>(std::min<uint64_t>(chunkSize, end - at));
+            size_t readSize = static_cast<size_t>(std::min<uint64_t>(size + len - 1, end - at));
+
+            if (tasks.empty() || tasks.back().bytes + readSize > chunkSize)
+            {
+                tasks.push_back({ chunks.size(), chunks.size(), 0 });
+            }
+
+            chunks.push_back({ at, size, readSize });
+            tasks.back().last = chunks.size();
+            tasks.back().bytes += readSize;
+        }
     }
+}
 
-    if (!target || len == 0)
+template <typename Find>
+void CGPMemoryEngine::ScanWith(const AddrRange& range, size_t len, Find&& find)
+{
+    if (!UpdateRegionMap(range))
     {
-        SetError(CGPErrorCode::Invalid_Argument, "target || len : ScanMemory");
         return;
     }
 
-    vm_size_t size = range.end - range.start;
-    vm_address_t address = range.start;
-    kern_return_t kr;
+    std::vector<ScanChunk> chunks;
+    std::vector<ScanTask> tasks;
+    PlanScan(regionMap_, range, len, scanChunkSize_, chunks, tasks);
 
-    while (address < range.end)
+    CGPThreadPool* pool = ThreadPool();
+    size_t bufferSize = scanChunkSize_ + len - 1;
+
+    std::vector<ScanLane> lanes(pool->Size());
+
+    // one partial result per task keeps the merge in address order
+    std::vector<Result> partial(tasks.size());
+
+    pool->Run(tasks.size(), [&](size_t task, size_t worker)
     {
-        vm_size_t vmsize;
-        vm_region_basic_info_data_64_t info;
-        mach_msg_type_number_t count = VM_REGION_BASIC_INFO_COUNT_64;
-        memory_object_name_t object;
+        const ScanTask& work = tasks[task];
+        ScanLane& lane = lanes[worker];
+        uint8_t* buffer = lane.Buffer(bufferSize);
 
-        kr = vm_region_64(task_, &address, &vmsize, VM_REGION_BASIC_INFO_64,
-                          reinterpret_cast<vm_region_info_t>(&info), &count, &object);
-        if (kr != KERN_SUCCESS)
+        if (!buffer)
         {
-            address += vmsize;
-            continue;
+            return;
         }
 
-        auto buffer = std::make_unique< std::vector<uint8_t> >(vmsize);
-        size_t bytesRead = 0;
+        lane.ops.clear();
 
-        kr = vm_read_overwrite(task_, address, vmsize,
-                               reinterpret_cast<vm_address_t>(buffer->data()), &bytesRead);
-        if (kr != KERN_SUCCESS)
-        {
-            address += vmsize;
-            continue;
-        }
+        size_t offset = 0;
 
-        if (bytesRead > vmsize)
+        for (size_t i = work.first; i < work.last; ++i)
         {
-            bytesRead = vmsize;
+            lane.ops.push_back({ chunks[i].address, buffer + offset, chunks[i].readSize, 0 });
+            offset += chunks[i].readSize;
         }
 
-        for (size_t i = 0; i <= bytesRead - len; ++i)
+        backend_->ReadBatch(lane.ops.data(), lane.ops.size());
+
+        // an unreadable chunk only loses itself, a short read keeps its prefix
+        for (size_t i = 0; i < lane.ops.size(); ++i)
         {
-            if (memcmp(buffer->data() + i, target, len) == 0)
-            {
-                auto region = std::make_unique<ResultRegion>();
-                region->region_base = address + i;
-                region->slide.push_back(static_cast<uint32_t>(i));
-                result_->resultBuffer.emplace_back(std::move(region));
-                result_->count++;
-            }
+            lane.hits.clear();
+            find(static_cast<const uint8_t*>(lane.ops[i].buffer), lane.ops[i].transferred, lane.ops[i].address, lane.hits);
+
+            // hits in the overlap belong to the next chunk
+            size_t limit = chunks[work.first + i].size;
+            lane.hits.erase(std::lower_bound(lane.hits.begin(), lane.hits.end(), limit), lane.hits.end());
+
+            partial[task].Append(lane.ops[i].address, lane.hits.data(), lane.hits.size());
         }
+    });
 
-        address += vmsize;
-    }
-}
+    DetachResultFile();
 
-void CGPMemoryEngine::NearBySearch(int range, const void* target, size_t len)
-{
-    if (!IsValid())
+    uint64_t lowest = UINT64_MAX;
+
+    for (const auto& part : partial)
     {
-        return;
+        if (part.count != 0)
+        {
+            lowest = part.regions[0].region_base;
+            break;
+        }
     }
 
-    if (range <= 0 || !target || len == 0)
+    if (lowest == UINT64_MAX)
     {
-        SetError(CGPErrorCode::Invalid_Argument, "range || target || len : NearBySearch");
         return;
     }
 
-    std::vector< std::unique_ptr<ResultRegion> > newResultBuffer;
+    // real hits end the every-value-is-a-candidate state of a fresh snapshot
+    snapshotAll_ = false;
 
-    for (const auto& region : result_->resultBuffer)
+    // hits above everything stored are appended, a scan below or across earlier ones is merged
+    if (result_->count == 0 || lowest > CGPResultRange(result_->View())[result_->count - 1])
     {
-        vm_address_t base = region->region_base;
-
-        for (int i = -range; i <= range; ++i)
+        for (const auto& part : partial)
         {
-            vm_address_t address = base + i * static_cast<int>(len);
+            result_->AppendResult(part);
+        }
+
+        return;
+    }
 
-            auto readResult = ReadMemory(address, len);
+    Result found;
 
-            if (readResult && readResult->size() == len)
-            {
-                if (memcmp(readResult->data(), target, len) == 0)
-                {
-                    auto newRegion = std::make_unique<ResultRegion>();
-                    newRegion->region_base = address;
-                    newResultBuffer.emplace_back(std::move(newRegion));
-                }
-            }
-        }
+    for (auto& part : partial)
+    {
+        found.AppendResult(part);
+        part = Result();
     }
 
-    result_->resultBuffer = std::move(newResultBuffer);
-    result_->count = static_cast<int>(result_->resultBuffer.size());
+    Result merged;
+    CGPResultSet::Combine(result_->View(), found.View(), CGPResultSetOp::Union, merged, pool);
+    *result_ = std::move(merged);
 }
 
-bool CGPMemoryEngine::SearchByAddress(uint64_t address, const void* target, size_t len)
+/* Offset of the first stride aligned value at or after address */
+static inline size_t AlignedOffset(uint64_t address, size_t stride)
+{
+    return static_cast<size_t>((stride - address % stride) % stride);
+}
+
+void CGPMemoryEngine::ScanMemory(const AddrRange& range, const void* target, size_t len)
 {
     if (!IsValid())
     {
-        return false;
+        return;
     }
 
     if (!target || len == 0)
     {
-        SetError(CGPErrorCode::Invalid_Argument, "target || len : SearchByAddress");
-        return false;
+        SetError(CGPErrorCode::Invalid_Argument, "target || len : ScanMemory");
+        return;
     }
 
-    auto readResult = ReadMemory(address, len);
+    size_t stride = ScanStride(len);
 
-    if (readResult && readResult->size() == len)
+    ScanWith(range, len, [&](const uint8_t* data, size_t size, uint64_t address, std::vector<size_t>& hits)
     {
-        return (memcmp(readResult->data(), target, len) == 0);
-    }
+        CGPScanKernel::FindAligned(data, size, AlignedOffset(address, stride), stride, target, len, hits);
+    });
+}
 
-    return false;
+static inline bool NeedsBound(CGPCompare predicate)
+{
+    return predicate == CGPCompare::Between || predicate == CGPCompare::EqualEpsilon;
 }
 
-std::unique_ptr< std::vector<uint8_t> > CGPMemoryEngine::ReadMemory(uint64_t address, size_t len) const
+void CGPMemoryEngine::ScanMemory(const AddrRange& range, CGPValueType type, CGPCompare predicate, const void* value, const void* bound)
 {
     if (!IsValid())
     {
-        return nullptr;
+        return;
     }
 
-    if (len == 0)
+    if (!value || (NeedsBound(predicate) && !bound))
     {
-        SetError(CGPErrorCode::Invalid_Argument, "len == 0 : ReadMemory");
-        return nullptr;
+        SetError(CGPErrorCode::Invalid_Argument, "value || bound : ScanMemory");
+        return;
     }
 
-    auto buffer = std::make_unique< std::vector<uint8_t> >(len);
-    vm_size_t bytesRead = 0;
-    kern_return_t kr = vm_read_overwrite(task_, address, len,
-                                        reinterpret_cast<vm_address_t>(buffer->data()), &bytesRead);
-
-    if (kr != KERN_SUCCESS || bytesRead != len)
-    { // Error description mach_error_string(kr)
-        SetError(CGPErrorCode::VMRead_Fail, "Failed to ReadMemory");
-        return nullptr;
-    }
+    CGPValueScanFn scan = CGPScanKernel::ValueScanner(type, predicate);
+    size_t width = CGPValueSize(type);
+    size_t stride = ScanStride(width);
 
-    return buffer;
+    ScanWith(range, width, [&](const uint8_t* data, size_t size, uint64_t address, std::vector<size_t>& hits)
+    {
+        scan(data, size, AlignedOffset(address, stride), stride, static_cast<const uint8_t*>(value),
+             static_cast<const uint8_t*>(bound), hits);
+    });
 }
 
-bool CGPMemoryEngine::WriteMemory(uint64_t address, const void* data, size_t len)
+typedef struct _group_slot {
+    const uint8_t* value;
+    size_t size;
+    size_t group;          // slots with the same type and value share a group
+    size_t stride;
+    CGPValueScanFn find;
+} GroupSlot;
+
+typedef struct _group_lane {
+    ScanLane scan;
+    std::vector< std::vector<size_t> > found; // per group, ascending offsets inside the anchor window
+    std::vector<size_t> starts;
+} GroupLane;
+
+/* Offsets of every group value lying whole inside data[lo, hi) */
+static void CollectGroups(const std::vector<GroupSlot>& slots, const std::vector<size_t>& leaders, const uint8_t* data,
+                          uint64_t address, size_t lo, size_t hi, std::vector< std::vector<size_t> >& found)
 {
-    if (!IsValid())
+    for (size_t g = 0; g < leaders.size(); ++g)
     {
-        return false;
+        const GroupSlot& slot = slots[leaders[g]];
+        std::vector<size_t>& list = found[g];
+
+        list.clear();
+        slot.find(data + lo, hi - lo, AlignedOffset(address + lo, slot.stride), slot.stride, slot.value, nullptr, list);
+
+        for (size_t& offset : list)
+        {
+            offset += lo;
+        }
     }
+}
 
-    if (!data || len == 0)
+/* Closest chain around the anchor, each slot after the previous one without overlap */
+static bool MatchOrdered(const std::vector<GroupSlot>& slots, const std::vector< std::vector<size_t> >& found,
+                         size_t anchor, size_t at, size_t span, std::vector<size_t>& members)
+{
+    size_t first = at;
+    size_t end = at + slots[anchor].size;
+
+    members.assign(slots.size(), 0);
+    members[anchor] = at;
+
+    for (size_t j = anchor; j-- > 0;)
     {
-        SetError(CGPErrorCode::Invalid_Argument, "data || len : WriteMemory");
-        return false;
+        const std::vector<size_t>& list = found[slots[j].group];
+
+        if (first < slots[j].size)
+        {
+            return false;
+        }
+
+        auto it = std::upper_bound(list.begin(), list.end(), first - slots[j].size);
+
+        if (it == list.begin())
+        {
+            return false;
+        }
+
+        first = *--it;
+        members[j] = first;
     }
 
-    kern_return_t kr = vm_write(task_, static_cast<vm_address_t>(address),
-                                reinterpret_cast<vm_offset_t>(const_cast<void*>(data)),
-                                static_cast<mach_msg_type_number_t>(len));
-    if (kr != KERN_SUCCESS)
-    { // Error description mach_error_string(kr)
-        SetError(CGPErrorCode::VMWrite_Fail, "Failed to WriteMemory");
-        return false;
+    for (size_t j = anchor + 1; j < slots.size(); ++j)
+    {
+        const std::vector<size_t>& list = found[slots[j].group];
+        auto it = std::lower_bound(list.begin(), list.end(), end);
+
+        if (it == list.end())
+        {
+            return false;
+        }
+
+        members[j] = *it;
+        end = *it + slots[j].size;
     }
 
-    return true;
+    return end - first <= span;
 }
 
-std::vector<void*> CGPMemoryEngine::GetAllResults() const
+/* First window [start, start + span) holding the anchor and enough of every group, windows start on a member */
+static bool MatchUnordered(const std::vector<GroupSlot>& slots, const std::vector<size_t>& leaders,
+                           const std::vector< std::vector<size_t> >& found, size_t at, size_t anchorSize, size_t span,
+                           std::vector<size_t>& starts, std::vector<size_t>& members)
 {
-    if (!IsValid())
+    size_t lowest = (at + anchorSize > span) ? at + anchorSize - span : 0;
+
+    starts.clear();
+
+    for (const auto& list : found)
     {
-        return {};
+        for (auto it = std::lower_bound(list.begin(), list.end(), lowest); it != list.end() && *it <= at; ++it)
+        {
+            starts.push_back(*it);
+        }
     }
 
-    std::vector<void*> addresses;
-    addresses.reserve(result_->resultBuffer.size());
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+    std::vector<size_t> need(leaders.size(), 0);
 
-    for (const auto& region : result_->resultBuffer)
+    for (const auto& slot : slots)
     {
-        if (region)
+        ++need[slot.group];
+    }
+
+    for (size_t start : starts)
+    {
+        size_t end = start + span;
+        bool complete = true;
+
+        for (size_t g = 0; g < leaders.size() && complete; ++g)
+        {
+            const std::vector<size_t>& list = found[g];
+            size_t size = slots[leaders[g]].size;
+
+            auto from = std::lower_bound(list.begin(), list.end(), start);
+            auto to = std::upper_bound(from, list.end(), end - size);
+
+            complete = static_cast<size_t>(to - from) >= need[g];
+        }
+
+        if (!complete)
+        {
+            continue;
+        }
+
+        members.clear();
+
+        for (size_t g = 0; g < leaders.size(); ++g)
         {
-            addresses.emplace_back(reinterpret_cast<void*>(region->region_base));
+            auto from = std::lower_bound(found[g].begin(), found[g].end(), start);
+            members.insert(members.end(), from, from + need[g]);
         }
+
+        return true;
     }
 
-    return addresses;
+    return false;
 }
 
-std::vector<void*> CGPMemoryEngine::GetResults(int count) const
+/*
+ * One pass over the regions: chunks overlap by maxSpan - 1 so every cluster
+ * sits whole in some read. Only the rarest value, sampled from chunks spread
+ * across the range, is searched across the chunk, the others only around its hits.
+ */
+void CGPMemoryEngine::GroupSearch(const AddrRange& range, const std::vector<GroupValue>& values, size_t maxSpan, bool ordered)
 {
     if (!IsValid())
     {
-        return {};
+        return;
     }
 
-    std::vector<void*> addresses;
+    size_t widest = 0;
 
-    if (count <= 0)
+    for (const auto& value : values)
     {
-        return addresses;
+        widest = std::max(widest, CGPValueSize(value.type));
     }
 
-    size_t actualCount = std::min(static_cast<size_t>(count), result_->resultBuffer.size());
-    addresses.reserve(actualCount);
+    if (values.empty() || maxSpan < widest)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "values || maxSpan : GroupSearch");
+        return;
+    }
+
+    std::vector<GroupSlot> slots;
+    std::vector<size_t> leaders;
 
-    for (size_t i = 0; i < actualCount; ++i)
+    for (size_t j = 0; j < values.size(); ++j)
     {
-        if (result_->resultBuffer[i])
+        size_t size = CGPValueSize(values[j].type);
+        GroupSlot slot = { reinterpret_cast<const uint8_t*>(&values[j].bits), size, leaders.size(), ScanStride(size),
+                           CGPScanKernel::ValueScanner(values[j].type, CGPCompare::Equal) };
+
+        for (size_t g = 0; g < leaders.size(); ++g)
+        {
+            const GroupValue& leader = values[leaders[g]];
+
+            if (leader.type == values[j].type && memcmp(&leader.bits, &values[j].bits, slot.size) == 0)
+            {
+                slot.group = g;
+                break;
+            }
+        }
+
+        if (slot.group == leaders.size())
         {
-            addresses.emplace_back(reinterpret_cast<void*>(result_->resultBuffer[i]->region_base));
+            leaders.push_back(j);
         }
+
+        slots.push_back(slot);
     }
 
-    return addresses;
-}
+    if (!UpdateRegionMap(range))
+    {
+        return;
+    }
 
-void* CGPMemoryEngine::AllocateMemory(size_t size)
-{
-    if (!IsValid())
+    std::vector<ScanChunk> chunks;
+    std::vector<ScanTask> tasks;
+    PlanScan(regionMap_, range, maxSpan, scanChunkSize_, chunks, tasks);
+
+    if (chunks.empty())
     {
-        return nullptr;
+        ResetResults();
+        return;
     }
 
-    if (size == 0)
+    CGPThreadPool* pool = ThreadPool();
+    size_t bufferSize = scanChunkSize_ + maxSpan - 1;
+    std::vector<GroupLane> lanes(pool->Size());
+
+    // sample a slice of chunks spread over the range for the rarest value, ties go to the wider one
+    size_t anchor = 0;
+    uint8_t* sample = lanes[0].scan.Buffer(bufferSize);
+
+    if (sample)
     {
-        SetError(CGPErrorCode::Invalid_Argument, "size == 0 : AllocateMemory");
-        return nullptr;
+        size_t samples = std::min<size_t>({ chunks.size(), CGP_Group_Sample_Chunks, std::max<size_t>(1, bufferSize / pageSize_) });
+        size_t sliceSize = std::max(pageSize_, std::min<size_t>(bufferSize / samples, CGP_Group_Sample_Bytes) & ~(pageSize_ - 1));
+        std::vector<RemoteIO>& ops = lanes[0].scan.ops;
+
+        ops.clear();
+
+        for (size_t k = 0; k < samples; ++k)
+        {
+            const ScanChunk& chunk = chunks[k * chunks.size() / samples];
+            ops.push_back({ chunk.address, sample + k * sliceSize, std::min(chunk.readSize, sliceSize), 0 });
+        }
+
+        backend_->ReadBatch(ops.data(), ops.size());
+
+        size_t rarest = SIZE_MAX;
+        std::vector<size_t>& hits = lanes[0].scan.hits;
+
+        for (size_t g = 0; g < leaders.size(); ++g)
+        {
+            const GroupSlot& slot = slots[leaders[g]];
+
+            hits.clear();
+
+            for (const auto& op : ops)
+            {
+                slot.find(static_cast<const uint8_t*>(op.buffer), op.transferred, AlignedOffset(op.address, slot.stride),
+                          slot.stride, slot.value, nullptr, hits);
+            }
+
+            if (hits.size() < rarest || (hits.size() == rarest && slot.size > slots[anchor].size))
+            {
+                rarest = hits.size();
+                anchor = leaders[g];
+            }
+        }
     }
 
-    vm_address_t address = 0;
-    kern_return_t kr = vm_allocate(task_, &address, size, VM_FLAGS_ANYWHERE);
-    if (kr != KERN_SUCCESS)
-    { // Error description mach_error_string(kr)
-        SetError(CGPErrorCode::Allocation_Fail, "Failed to AllocateMemory");
-        return nullptr;
+    const GroupSlot& lead = slots[anchor];
+    std::vector< std::vector<uint64_t> > partial(tasks.size());
+
+    pool->Run(tasks.size(), [&](size_t task, size_t worker)
+    {
+        const ScanTask& work = tasks[task];
+        GroupLane& lane = lanes[worker];
+        uint8_t* buffer = lane.scan.Buffer(bufferSize);
+
+        if (!buffer)
+        {
+            return;
+        }
+
+        lane.found.resize(leaders.size());
+        lane.scan.ops.clear();
+
+        size_t offset = 0;
+
+        for (size_t i = work.first; i < work.last; ++i)
+        {
+            lane.scan.ops.push_back({ chunks[i].address, buffer + offset, chunks[i].readSize, 0 });
+            offset += chunks[i].readSize;
+        }
+
+        backend_->ReadBatch(lane.scan.ops.data(), lane.scan.ops.size());
+
+        std::vector<size_t> members;
+
+        for (const auto& op : lane.scan.ops)
+        {
+            const uint8_t* data = static_cast<const uint8_t*>(op.buffer);
+
+            lane.scan.hits.clear();
+            lead.find(data, op.transferred, AlignedOffset(op.address, lead.stride), lead.stride, lead.value, nullptr,
+                      lane.scan.hits);
+
+            // the overlap is searched too, a cluster may start in this chunk and end past it
+            for (size_t at : lane.scan.hits)
+            {
+                size_t lo = (at + lead.size > maxSpan) ? at + lead.size - maxSpan : 0;
+                size_t hi = std::min(op.transferred, at + maxSpan);
+
+                CollectGroups(slots, leaders, data, op.address, lo, hi, lane.found);
+
+                bool matched = ordered ? MatchOrdered(slots, lane.found, anchor, at, maxSpan, members)
+                                       : MatchUnordered(slots, leaders, lane.found, at, lead.size, maxSpan, lane.starts, members);
+
+                if (!matched)
+                {
+                    continue;
+                }
+
+                for (size_t member : members)
+                {
+                    partial[task].push_back(op.address + member);
+                }
+            }
+        }
+    });
+
+    std::vector<uint64_t> found;
+
+    for (const auto& part : partial)
+    {
+        found.insert(found.end(), part.begin(), part.end());
     }
 
-    return reinterpret_cast<void*>(address);
+    // overlapping reads and neighbouring anchors report members more than once
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    ResetResults();
+    result_->AppendAddresses(found.data(), found.size());
 }
 
-bool CGPMemoryEngine::DeallocateMemory(void* address, size_t size)
+void CGPMemoryEngine::SetScanThreads(size_t threads)
 {
-    if (!IsValid())
+    if (scanThreads_ != threads)
     {
-        return false;
+        scanThreads_ = threads;
+        threadPool_.reset();
     }
+}
 
-    if (!address || size == 0)
+void CGPMemoryEngine::SetScanAlignment(size_t alignment)
+{
+    if (alignment & (alignment - 1))
     {
-        SetError(CGPErrorCode::Invalid_Argument, "address || size : DeallocateMemory");
-        return false;
+        SetError(CGPErrorCode::Invalid_Argument, "alignment : SetScanAlignment");
+        return;
+    }
+
+    scanAlignment_ = alignment;
+}
+
+size_t CGPMemoryEngine::ScanStride(size_t width) const
+{
+    if (scanAlignment_ != 0)
+    {
+        return scanAlignment_;
+    }
+
+    // natural alignment for value sized targets, anything else can start anywhere
+    return (width <= 8 && (width & (width - 1)) == 0) ? width : 1;
+}
+
+void CGPMemoryEngine::SetRegionFilter(const RegionFilter& filter)
+{
+    regionFilter_ = filter;
+}
+
+bool CGPMemoryEngine::UpdateRegionMap(const AddrRange& range)
+{
+    regionMap_.clear();
+
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    return CollectRegions(range, regionMap_);
+}
+
+bool CGPMemoryEngine::CollectRegions(const AddrRange& range, std::vector<RegionInfo>& regions) const
+{
+    if (!backend_->EnumerateRegions(range, regions))
+    {
+        return false;
+    }
+
+    regions.erase(std::remove_if(regions.begin(), regions.end(),
+                                 [this](const RegionInfo& region) { return !regionFilter_.Matches(region); }),
+                  regions.end());
+
+    return !regions.empty();
+}
+
+void CGPMemoryEngine::SetScanChunkSize(size_t bytes)
+{
+    size_t pages = (std::max(bytes, pageSize_) + pageSize_ - 1) / pageSize_;
+    scanChunkSize_ = pages * pageSize_;
+}
+
+CGPThreadPool* CGPMemoryEngine::ThreadPool()
+{
+    if (!threadPool_)
+    {
+        threadPool_ = std::make_unique<CGPThreadPool>(scanThreads_);
+    }
+
+    return threadPool_.get();
+}
+
+static inline void MergeWindow(std::vector<AddrRange>& windows, uint64_t start, uint64_t end)
+{
+    if (!windows.empty() && start <= windows.back().end)
+    {
+        windows.back().end = std::max(windows.back().end, end);
+        return;
+    }
+
+    windows.push_back({ start, end });
+}
+
+/* lane holds merged windows of one address phase, true if [address, address + len) fits one */
+static inline bool InWindow(const std::vector<AddrRange>& lane, uint64_t address, size_t len)
+{
+    auto it = std::upper_bound(lane.begin(), lane.end(), address,
+                               [](uint64_t value, const AddrRange& window) { return value < window.start; });
+    if (it == lane.begin())
+    {
+        return false;
+    }
+
+    --it;
+    return address + len <= it->end;
+}
+
+template <typename Find>
+bool CGPMemoryEngine::NearByWith(int range, size_t len, Find&& find)
+{
+    ResultView source = CurrentResults();
+    uint64_t reach = static_cast<uint64_t>(range) * len;
+
+    size_t bufferSize = scanChunkSize_ + len - 1;
+    std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[bufferSize]);
+
+    if (!buffer)
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> addresses;
+    std::vector<uint64_t> found;
+    std::vector< std::vector<AddrRange> > lanes(len);
+    std::vector<AddrRange> spans;
+    std::vector<AddrRange> extents;
+    std::vector<RegionInfo> regions;
+    std::vector<RemoteIO> pieces;
+    std::vector<size_t> hits;
+
+    size_t next = 0;
+
+    while (next < source.region_count)
+    {
+        addresses.clear();
+
+        while (next < source.region_count && (addresses.empty() || addresses.size() < CGP_Refine_Batch_Hits))
+        {
+            source.ForEachInRegion(source.regions[next++], [&](uint64_t address)
+            {
+                addresses.push_back(address);
+                return true;
+            });
+        }
+
+        // slots sit at base + i * len, so windows only merge within the same address phase
+        for (auto& lane : lanes)
+        {
+            lane.clear();
+        }
+
+        spans.clear();
+
+        for (uint64_t base : addresses)
+        {
+            uint64_t start = (base >= reach) ? base - reach : 0;
+            uint64_t end = base + reach + len;
+
+            MergeWindow(lanes[base % len], start, end);
+            MergeWindow(spans, start, end);
+        }
+
+        // clip to readable memory, adjacent regions stay joined for values crossing them
+        extents.clear();
+
+        if (CollectRegions(AddrRange{ spans.front().start, spans.back().end }, regions))
+        {
+            for (const auto& region : regions)
+            {
+                MergeWindow(extents, region.start, region.start + region.size);
+            }
+        }
+
+        pieces.clear();
+
+        size_t extent = 0;
+
+        for (const auto& span : spans)
+        {
+            while (extent < extents.size() && extents[extent].end <= span.start)
+            {
+                ++extent;
+            }
+
+            for (size_t e = extent; e < extents.size() && extents[e].start < span.end; ++e)
+            {
+                uint64_t start = std::max(span.start, extents[e].start);
+                uint64_t end = std::min(span.end, extents[e].end);
+
+                // oversized spans are cut like scan chunks, overlapping by len - 1
+                for (uint64_t at = start; at + len <= end; at += scanChunkSize_)
+                {
+                    size_t size = static_cast<size_t>(std::min<uint64_t>(scanChunkSize_ + len - 1, end - at));
+                    pieces.push_back({ at, nullptr, size, 0 });
+                }
+            }
+        }
+
+        size_t piece = 0;
+
+        while (piece < pieces.size())
+        {
+            size_t first = piece;
+            size_t used = 0;
+
+            while (piece < pieces.size() && used + pieces[piece].len <= bufferSize)
+            {
+                pieces[piece].buffer = buffer.get() + used;
+                used += pieces[piece].len;
+                ++piece;
+            }
+
+            backend_->ReadBatch(pieces.data() + first, piece - first);
+
+            for (size_t i = first; i < piece; ++i)
+            {
+                hits.clear();
+                find(static_cast<const uint8_t*>(pieces[i].buffer), pieces[i].transferred, pieces[i].address, hits);
+
+                for (size_t offset : hits)
+                {
+                    uint64_t address = pieces[i].address + offset;
+
+                    if (InWindow(lanes[address % len], address, len))
+                    {
+                        found.push_back(address);
+                    }
+                }
+            }
+        }
+    }
+
+    // overlapping pieces and batches can report a hit twice
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    ResetResults();
+    result_->AppendAddresses(found.data(), found.size());
+    return true;
+}
+
+void CGPMemoryEngine::NearBySearch(int range, const void* target, size_t len)
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    if (range <= 0 || !target || len == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "range || target || len : NearBySearch");
+        return;
+    }
+
+    size_t stride = ScanStride(len);
+
+    bool searched = NearByWith(range, len, [&](const uint8_t* data, size_t size, uint64_t address, std::vector<size_t>& hits)
+    {
+        CGPScanKernel::FindAligned(data, size, AlignedOffset(address, stride), stride, target, len, hits);
+    });
+
+    if (!searched)
+    {
+        SetError(CGPErrorCode::Allocation_Fail, "buffer : NearBySearch");
+    }
+}
+
+void CGPMemoryEngine::NearBySearch(int range, CGPValueType type, CGPCompare predicate, const void* value, const void* bound)
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    if (range <= 0 || !value || (NeedsBound(predicate) && !bound))
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "range || value || bound : NearBySearch");
+        return;
+    }
+
+    CGPValueScanFn scan = CGPScanKernel::ValueScanner(type, predicate);
+    size_t width = CGPValueSize(type);
+    size_t stride = ScanStride(width);
+
+    bool searched = NearByWith(range, width, [&](const uint8_t* data, size_t size, uint64_t address, std::vector<size_t>& hits)
+    {
+        scan(data, size, AlignedOffset(address, stride), stride, static_cast<const uint8_t*>(value),
+             static_cast<const uint8_t*>(bound), hits);
+    });
+
+    if (!searched)
+    {
+        SetError(CGPErrorCode::Allocation_Fail, "buffer : NearBySearch");
+    }
+}
+
+/*
+ * Page aligned spans covering [address, address + len) of every sorted address.
+ * Touching spans merge until they reach maxSpan, so each page is read once.
+ */
+static void PlanSpans(const uint64_t* addresses, size_t n, size_t len, uint64_t pageSize, uint64_t maxSpan,
+                      std::vector<RemoteIO>& spans)
+{
+    uint64_t mask = ~(pageSize - 1);
+
+    spans.clear();
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t start = addresses[i] & mask;
+        uint64_t end = ((addresses[i] + len - 1) & mask) + pageSize;
+
+        if (!spans.empty())
+        {
+            RemoteIO& last = spans.back();
+            uint64_t lastEnd = last.address + last.len;
+
+            if (start <= lastEnd && last.len < maxSpan)
+            {
+                last.len = static_cast<size_t>(std::max(end, lastEnd) - last.address);
+                continue;
+            }
+        }
+
+        spans.push_back({ start, nullptr, static_cast<size_t>(end - start), 0 });
+    }
+}
+
+template <typename Keep>
+bool CGPMemoryEngine::RefineWith(size_t len, Keep&& keep)
+{
+    // a mapped result file is read in place, the survivors are built up in result_
+    ResultView source = CurrentResults();
+    bool mapped = (resultFile_ != nullptr);
+    CGPResultCompactor compactor(*result_);
+
+    // a span is capped at the chunk size but may run one value and one page past it
+    size_t bufferSize = scanChunkSize_ + len + 2 * pageSize_;
+    std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[bufferSize]);
+
+    if (!buffer)
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> addresses;
+    std::vector<size_t> regionEnds;
+    std::vector<RemoteIO> spans;
+    std::vector<uint8_t> kept;
+
+    size_t next = 0;
+    size_t regionCount = source.region_count;
+
+    while (next < regionCount)
+    {
+        addresses.clear();
+        regionEnds.clear();
+
+        // decode a batch of regions before the compactor may overwrite them
+        while (next < regionCount && (regionEnds.empty() || addresses.size() < CGP_Refine_Batch_Hits))
+        {
+            source.ForEachInRegion(source.regions[next], [&](uint64_t address)
+            {
+                addresses.push_back(address);
+                return true;
+            });
+
+            regionEnds.push_back(addresses.size());
+            ++next;
+        }
+
+        PlanSpans(addresses.data(), addresses.size(), len, pageSize_, scanChunkSize_, spans);
+        kept.assign(addresses.size(), 0);
+
+        size_t hit = 0;
+        size_t span = 0;
+
+        while (span < spans.size())
+        {
+            size_t first = span;
+            size_t used = 0;
+
+            while (span < spans.size() && (span == first || used + spans[span].len <= bufferSize))
+            {
+                spans[span].buffer = buffer.get() + used;
+                used += spans[span].len;
+                ++span;
+            }
+
+            backend_->ReadBatch(spans.data() + first, span - first);
+
+            // every hit lies whole inside the first span reaching its last byte
+            size_t at = first;
+
+            while (hit < addresses.size())
+            {
+                uint64_t address = addresses[hit];
+
+                while (at < span && address + len > spans[at].address + spans[at].len)
+                {
+                    ++at;
+                }
+
+                if (at == span)
+                {
+                    break;
+                }
+
+                size_t offset = static_cast<size_t>(address - spans[at].address);
+
+                if (spans[at].transferred >= offset + len)
+                {
+                    kept[hit] = keep(address, static_cast<const uint8_t*>(spans[at].buffer) + offset, spans[at]);
+                }
+
+                ++hit;
+            }
+        }
+
+        size_t begin = 0;
+
+        for (size_t end : regionEnds)
+        {
+            size_t count = begin;
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (kept[i])
+                {
+                    addresses[count++] = addresses[i];
+                }
+            }
+
+            if (mapped)
+            {
+                result_->AppendRegion(addresses.data() + begin, count - begin);
+            }
+            else
+            {
+                compactor.Keep(addresses.data() + begin, count - begin);
+            }
+
+            begin = end;
+        }
+    }
+
+    if (mapped)
+    {
+        resultFile_.reset();
+    }
+    else
+    {
+        compactor.Finish();
+    }
+
+    return true;
+}
+
+void CGPMemoryEngine::RefineResults(const void* target, size_t len, CGPCompare predicate)
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    if (!target || len == 0 || (predicate != CGPCompare::Equal && predicate != CGPCompare::NotEqual))
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "target || len || predicate : RefineResults");
+        return;
+    }
+
+    bool wantEqual = (predicate == CGPCompare::Equal);
+
+    bool refined = RefineWith(len, [&](uint64_t, const uint8_t* value, const RemoteIO&)
+    {
+        return (memcmp(value, target, len) == 0) == wantEqual;
+    });
+
+    if (!refined)
+    {
+        SetError(CGPErrorCode::Allocation_Fail, "buffer : RefineResults");
+    }
+}
+
+void CGPMemoryEngine::RefineResults(CGPValueType type, CGPCompare predicate, const void* value, const void* bound)
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    if (!value || (NeedsBound(predicate) && !bound))
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "value || bound : RefineResults");
+        return;
+    }
+
+    CGPValueTestFn test = CGPScanKernel::ValueTester(type, predicate);
+    const uint8_t* operand = static_cast<const uint8_t*>(value);
+    const uint8_t* limit = static_cast<const uint8_t*>(bound);
+
+    bool refined = RefineWith(CGPValueSize(type), [&](uint64_t, const uint8_t* data, const RemoteIO&)
+    {
+        return test(data, operand, limit);
+    });
+
+    if (!refined)
+    {
+        SetError(CGPErrorCode::Allocation_Fail, "buffer : RefineResults");
+    }
+}
+
+bool CGPMemoryEngine::CaptureSnapshot(const AddrRange& range)
+{
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    ResetResults();
+    snapshot_.reset();
+    snapshotAll_ = false;
+
+    // whole pages only, so every aligned value sits inside one snapshot page
+    uint64_t mask = ~static_cast<uint64_t>(pageSize_ - 1);
+    uint64_t end = (range.end > UINT64_MAX - pageSize_) ? (range.end & mask) : ((range.end + pageSize_ - 1) & mask);
+    AddrRange pages = { range.start & mask, end };
+
+    if (!UpdateRegionMap(pages))
+    {
+        return false;
+    }
+
+    std::vector<ScanChunk> chunks;
+    std::vector<ScanTask> tasks;
+    PlanScan(regionMap_, pages, 1, scanChunkSize_, chunks, tasks);
+
+    CGPThreadPool* pool = ThreadPool();
+    std::vector<ScanLane> lanes(pool->Size());
+    std::vector<CGPSnapshot> partial(tasks.size(), CGPSnapshot(pageSize_));
+
+    pool->Run(tasks.size(), [&](size_t task, size_t worker)
+    {
+        const ScanTask& work = tasks[task];
+        ScanLane& lane = lanes[worker];
+        uint8_t* buffer = lane.Buffer(scanChunkSize_);
+
+        if (!buffer)
+        {
+            return;
+        }
+
+        lane.ops.clear();
+
+        size_t offset = 0;
+
+        for (size_t i = work.first; i < work.last; ++i)
+        {
+            lane.ops.push_back({ chunks[i].address, buffer + offset, chunks[i].size, 0 });
+            offset += chunks[i].size;
+        }
+
+        backend_->ReadBatch(lane.ops.data(), lane.ops.size());
+
+        // pages past a short read are left out, they cannot be compared later
+        for (const auto& op : lane.ops)
+        {
+            for (size_t at = 0; at + pageSize_ <= op.transferred; at += pageSize_)
+            {
+                partial[task].AddPage(op.address + at, static_cast<const uint8_t*>(op.buffer) + at);
+            }
+        }
+    });
+
+    size_t pageCount = 0;
+    size_t dataSize = 0;
+
+    for (const auto& part : partial)
+    {
+        pageCount += part.Pages().size();
+        dataSize += part.DataSize();
+    }
+
+    snapshot_ = std::make_unique<CGPSnapshot>(pageSize_);
+    snapshot_->Reserve(pageCount, dataSize);
+
+    for (const auto& part : partial)
+    {
+        snapshot_->AppendSnapshot(part);
+    }
+
+    snapshotAll_ = true;
+    return pageCount > 0;
+}
+
+void CGPMemoryEngine::RefineSnapshot(CGPValueType type, CGPSnapshotCompare mode, const void* delta)
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    bool byDelta = (mode == CGPSnapshotCompare::IncreasedBy || mode == CGPSnapshotCompare::DecreasedBy);
+
+    if (byDelta && !delta)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "delta : RefineSnapshot");
+        return;
+    }
+
+    if (!snapshot_)
+    {
+        SetError(CGPErrorCode::Invalid_State, "snapshot_ : RefineSnapshot");
+        return;
+    }
+
+    uint8_t value[sizeof(uint64_t)] = {};
+
+    if (byDelta)
+    {
+        memcpy(value, delta, CGPValueSize(type));
+    }
+
+    if (snapshotAll_)
+    {
+        RefineSnapshotPages(type, mode, value);
+    }
+    else
+    {
+        RefineSnapshotHits(type, mode, value);
+    }
+}
+
+/*
+ * First refine after CaptureSnapshot: every aligned value of every page is
+ * compared, pages are re-read in chunk sized batches across the pool. Only
+ * pages left holding a candidate are kept for the next refine.
+ */
+void CGPMemoryEngine::RefineSnapshotPages(CGPValueType type, CGPSnapshotCompare mode, const uint8_t* delta)
+{
+    CGPPageCompareFn compare = CGPSnapshot::PageComparer(type, mode);
+    size_t stride = ScanStride(CGPValueSize(type));
+
+    const std::vector<SnapshotPage>& pages = snapshot_->Pages();
+    size_t pagesPerTask = std::max<size_t>(1, scanChunkSize_ / pageSize_);
+    size_t taskCount = (pages.size() + pagesPerTask - 1) / pagesPerTask;
+
+    CGPThreadPool* pool = ThreadPool();
+    std::vector<ScanLane> lanes(pool->Size());
+    std::vector<Result> partial(taskCount);
+    std::vector<CGPSnapshot> partialPages(taskCount, CGPSnapshot(pageSize_));
+
+    pool->Run(taskCount, [&](size_t task, size_t worker)
+    {
+        size_t first = task * pagesPerTask;
+        size_t last = std::min(first + pagesPerTask, pages.size());
+
+        ScanLane& lane = lanes[worker];
+        uint8_t* buffer = lane.Buffer(scanChunkSize_);
+
+        if (!buffer)
+        {
+            return;
+        }
+
+        lane.page.resize(pageSize_);
+        lane.ops.clear();
+
+        // adjacent pages share one read
+        for (size_t i = first; i < last; ++i)
+        {
+            uint64_t address = pages[i].address;
+
+            if (!lane.ops.empty() && lane.ops.back().address + lane.ops.back().len == address)
+            {
+                lane.ops.back().len += pageSize_;
+                continue;
+            }
+
+            lane.ops.push_back({ address, buffer + (i - first) * pageSize_, pageSize_, 0 });
+        }
+
+        backend_->ReadBatch(lane.ops.data(), lane.ops.size());
+
+        uint64_t base = pages[first].address;
+        size_t op = 0;
+
+        lane.hits.clear();
+
+        for (size_t i = first; i < last; ++i)
+        {
+            uint64_t address = pages[i].address;
+
+            while (lane.ops[op].address + lane.ops[op].len <= address)
+            {
+                ++op;
+            }
+
+            size_t offset = static_cast<size_t>(address - lane.ops[op].address);
+
+            if (lane.ops[op].transferred < offset + pageSize_ || !snapshot_->LoadPage(i, lane.page.data()))
+            {
+                continue;
+            }
+
+            const uint8_t* now = static_cast<const uint8_t*>(lane.ops[op].buffer) + offset;
+            size_t found = lane.hits.size();
+
+            compare(now, lane.page.data(), pageSize_, stride, delta, lane.hits);
+
+            if (lane.hits.size() == found)
+            {
+                continue;
+            }
+
+            for (size_t k = found; k < lane.hits.size(); ++k)
+            {
+                lane.hits[k] += static_cast<size_t>(address - base);
+            }
+
+            partialPages[task].AddPage(address, now);
+        }
+
+        partial[task].Append(base, lane.hits.data(), lane.hits.size());
+    });
+
+    ResetResults();
+
+    size_t pageCount = 0;
+    size_t dataSize = 0;
+
+    for (size_t task = 0; task < taskCount; ++task)
+    {
+        result_->AppendResult(partial[task]);
+        pageCount += partialPages[task].Pages().size();
+        dataSize += partialPages[task].DataSize();
+    }
+
+    // a fresh snapshot gives the memory of dropped pages back
+    CGPSnapshot next(pageSize_);
+    next.Reserve(pageCount, dataSize);
+
+    for (const auto& part : partialPages)
+    {
+        next.AppendSnapshot(part);
+    }
+
+    *snapshot_ = std::move(next);
+    snapshotAll_ = false;
+}
+
+/* Later refines only visit current results, a page stays in the snapshot while it holds one */
+void CGPMemoryEngine::RefineSnapshotHits(CGPValueType type, CGPSnapshotCompare mode, const uint8_t* delta)
+{
+    CGPValueCompareFn compare = CGPSnapshot::ValueComparer(type, mode);
+
+    const std::vector<SnapshotPage>& pages = snapshot_->Pages();
+    uint64_t mask = ~static_cast<uint64_t>(pageSize_ - 1);
+
+    CGPSnapshot next(pageSize_);
+    std::vector<uint8_t> old(pageSize_);
+    size_t width = CGPValueSize(type);
+
+    size_t index = 0;
+    uint64_t loaded = UINT64_MAX;
+    uint64_t stored = UINT64_MAX;
+    bool valid = false;
+
+    bool refined = RefineWith(width, [&](uint64_t address, const uint8_t* value, const RemoteIO& span)
+    {
+        uint64_t page = address & mask;
+
+        if (address - page + width > pageSize_)
+        { // runs into the next page, which the snapshot keeps apart, as the first refine drops it
+            return false;
+        }
+
+        if (page != loaded)
+        {
+            while (index < pages.size() && pages[index].address < page)
+            {
+                ++index;
+            }
+
+            loaded = page;
+            valid = (index < pages.size() && pages[index].address == page && snapshot_->LoadPage(index, old.data()));
+        }
+
+        if (!valid || !compare(value, old.data() + (address - page), delta))
+        {
+            return false;
+        }
+
+        // spans are page aligned, the page is whole unless the read came up short
+        size_t offset = static_cast<size_t>(page - span.address);
+
+        if (page != stored && span.transferred >= offset + pageSize_)
+        {
+            next.AddPage(page, static_cast<const uint8_t*>(span.buffer) + offset);
+            stored = page;
+        }
+
+        return true;
+    });
+
+    if (!refined)
+    {
+        SetError(CGPErrorCode::Allocation_Fail, "buffer : RefineSnapshot");
+        return;
+    }
+
+    *snapshot_ = std::move(next);
+}
+
+size_t CGPMemoryEngine::GetSnapshotSize() const
+{
+    return snapshot_ ? snapshot_->Bytes() : 0;
+}
+
+/* Sorted, disjoint [start, end) spans a pointer must land in to be indexed */
+typedef struct _pointee_span {
+    uint64_t start;
+    uint64_t end;
+} PointeeSpan;
+
+static bool InSpans(const std::vector<PointeeSpan>& spans, uint64_t value)
+{
+    auto it = std::upper_bound(spans.begin(), spans.end(), value,
+                               [](uint64_t address, const PointeeSpan& span) { return address < span.start; });
+
+    return it != spans.begin() && value < (it - 1)->end;
+}
+
+/*
+ * Modules guessed from the region map: consecutive file backed regions of one
+ * path, plus the anonymous region right after them (.bss). Mach regions carry
+ * no path, there the caller passes PointerScanOptions::modules.
+ */
+static void CollectModules(const std::vector<RegionInfo>& regions, std::vector<PointerModule>& modules)
+{
+    modules.clear();
+
+    const std::string* path = nullptr;
+
+    for (const auto& region : regions)
+    {
+        uint64_t end = region.start + region.size;
+
+        if (region.file_backed && !region.path.empty() && region.path[0] == '/')
+        {
+            if (path && *path == region.path)
+            {
+                modules.back().end = end;
+                continue;
+            }
+
+            path = &region.path;
+
+            PointerModule module;
+            module.name = region.path.substr(region.path.find_last_of('/') + 1);
+            module.start = region.start;
+            module.end = end;
+            modules.push_back(module);
+        }
+        else if (!region.file_backed && !modules.empty() && modules.back().end == region.start)
+        {
+            modules.back().end = end;
+        }
+    }
+}
+
+bool CGPMemoryEngine::BuildPointerMap(const AddrRange& range, size_t maxPointers)
+{
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    pointerMap_.reset();
+    pointerModules_.clear();
+
+    if (!UpdateRegionMap(range))
+    {
+        return false;
+    }
+
+    std::vector<PointeeSpan> spans;
+    std::vector<RegionInfo> writable;
+
+    for (const auto& region : regionMap_)
+    {
+        if (!spans.empty() && spans.back().end == region.start)
+        {
+            spans.back().end = region.start + region.size;
+        }
+        else
+        {
+            spans.push_back({ region.start, region.start + region.size });
+        }
+
+        if (region.protection & CGP_Prot_Write)
+        {
+            writable.push_back(region);
+        }
+    }
+
+    CollectModules(regionMap_, pointerModules_);
+
+    std::vector<ScanChunk> chunks;
+    std::vector<ScanTask> tasks;
+    PlanScan(writable, range, sizeof(uint64_t), scanChunkSize_, chunks, tasks);
+
+    CGPThreadPool* pool = ThreadPool();
+    size_t bufferSize = scanChunkSize_ + sizeof(uint64_t) - 1;
+
+    std::vector<ScanLane> lanes(pool->Size());
+    std::vector< std::vector<PointerRef> > parts(pool->Size());
+
+    uint64_t low = spans.front().start;
+    uint64_t high = spans.back().end;
+
+    std::atomic<size_t> total(0);
+    std::atomic<bool> full(false);
+
+    pool->Run(tasks.size(), [&](size_t task, size_t worker)
+    {
+        const ScanTask& work = tasks[task];
+        ScanLane& lane = lanes[worker];
+        std::vector<PointerRef>& refs = parts[worker];
+        uint8_t* buffer = lane.Buffer(bufferSize);
+
+        if (!buffer || full.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        lane.ops.clear();
+
+        size_t offset = 0;
+
+        for (size_t i = work.first; i < work.last; ++i)
+        {
+            lane.ops.push_back({ chunks[i].address, buffer + offset, chunks[i].readSize, 0 });
+            offset += chunks[i].readSize;
+        }
+
+        backend_->ReadBatch(lane.ops.data(), lane.ops.size());
+
+        size_t before = refs.size();
+
+        for (size_t i = 0; i < lane.ops.size(); ++i)
+        {
+            const RemoteIO& op = lane.ops[i];
+            const uint8_t* data = static_cast<const uint8_t*>(op.buffer);
+            size_t limit = chunks[work.first + i].size;
+
+            for (size_t at = AlignedOffset(op.address, sizeof(uint64_t)); at < limit && at + sizeof(uint64_t) <= op.transferred;
+                 at += sizeof(uint64_t))
+            {
+                uint64_t value;
+                memcpy(&value, data + at, sizeof(value));
+
+                // most values are not addresses at all, the bounds reject them before the search
+                if (value < low || value >= high || !InSpans(spans, value))
+                {
+                    continue;
+                }
+
+                refs.push_back({ value, op.address + at });
+            }
+        }
+
+        if (maxPointers != 0 && total.fetch_add(refs.size() - before) + (refs.size() - before) > maxPointers)
+        {
+            full.store(true, std::memory_order_relaxed);
+        }
+    });
+
+    if (full.load())
+    { // over budget, nothing is kept
+        return false;
+    }
+
+    pointerMap_ = std::make_unique<CGPPointerMap>();
+    pointerMap_->Build(parts, *pool);
+
+    return pointerMap_->Size() > 0;
+}
+
+size_t CGPMemoryEngine::GetPointerMapSize() const
+{
+    return pointerMap_ ? pointerMap_->Size() : 0;
+}
+
+/* Depth first walk from the target back to module bases, one per pool lane */
+typedef struct _pointer_walk {
+    const CGPPointerMap* map;
+    const std::vector<PointerModule>* modules;
+    const PointerScanOptions* options;
+
+    FILE* file;
+    std::mutex* fileLock;
+    std::atomic<uint64_t>* found;
+
+    std::vector<uint64_t> offsets;  // offsets[d] is added after the d-th dereference counted from the target
+    std::string text;
+
+    const PointerModule* FindModule(uint64_t address) const
+    {
+        auto it = std::upper_bound(modules->begin(), modules->end(), address,
+                                   [](uint64_t value, const PointerModule& module) { return value < module.start; });
+
+        if (it == modules->begin() || address >= (it - 1)->end)
+        {
+            return nullptr;
+        }
+
+        return &*(it - 1);
+    }
+
+    bool Done() const
+    {
+        return options->max_results != 0 && found->load(std::memory_order_relaxed) >= options->max_results;
+    }
+
+    void Flush()
+    {
+        std::lock_guard<std::mutex> lock(*fileLock);
+        fwrite(text.data(), 1, text.size(), file);
+        text.clear();
+    }
+
+    void Emit(const PointerModule& module, uint64_t holder, size_t depth)
+    {
+        if (found->fetch_add(1, std::memory_order_relaxed) >= options->max_results && options->max_results != 0)
+        {
+            return;
+        }
+
+        char number[24];
+
+        text += module.name;
+        snprintf(number, sizeof(number), "+0x%llX", static_cast<unsigned long long>(holder - module.start));
+        text += number;
+
+        for (size_t d = depth + 1; d-- > 0;)
+        {
+            snprintf(number, sizeof(number), ",0x%llX", static_cast<unsigned long long>(offsets[d]));
+            text += number;
+        }
+
+        text += '\n';
+
+        if (text.size() >= (64u << 10))
+        {
+            Flush();
+        }
+    }
+
+    /* ref points at most max_offset below the address reached at depth */
+    void Follow(const PointerRef& ref, uint64_t address, size_t depth)
+    {
+        offsets[depth] = address - ref.value;
+
+        if (const PointerModule* module = FindModule(ref.holder))
+        {
+            Emit(*module, ref.holder, depth);
+        }
+        else if (depth + 1 < options->max_depth)
+        {
+            Walk(ref.holder, depth + 1);
+        }
+    }
+
+    void Walk(uint64_t address, size_t depth)
+    {
+        const PointerRef* refs;
+        uint64_t low = (address > options->max_offset) ? address - options->max_offset : 0;
+        size_t count = map->Find(low, address, &refs);
+
+        for (size_t i = 0; i < count && !Done(); ++i)
+        {
+            Follow(refs[i], address, depth);
+        }
+    }
+} PointerWalk;
+
+uint64_t CGPMemoryEngine::ScanPointerPaths(uint64_t target, const PointerScanOptions& options, const std::string& path)
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    if (!pointerMap_)
+    {
+        SetError(CGPErrorCode::Invalid_State, "pointerMap_ : ScanPointerPaths");
+        return 0;
+    }
+
+    if (options.max_depth == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "max_depth : ScanPointerPaths");
+        return 0;
+    }
+
+    std::vector<PointerModule> modules = options.modules.empty() ? pointerModules_ : options.modules;
+    std::sort(modules.begin(), modules.end(),
+              [](const PointerModule& a, const PointerModule& b) { return a.start < b.start; });
+
+    if (modules.empty())
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "modules : ScanPointerPaths");
+        return 0;
+    }
+
+    std::unique_ptr<FILE, int (*)(FILE*)> file(fopen(path.c_str(), "w"), fclose);
+
+    if (!file)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "path : ScanPointerPaths");
+        return 0;
+    }
+
+    CGPThreadPool* pool = ThreadPool();
+
+    std::mutex fileLock;
+    std::atomic<uint64_t> found(0);
+
+    std::vector<PointerWalk> walks(pool->Size());
+
+    for (auto& walk : walks)
+    {
+        walk.map = pointerMap_.get();
+        walk.modules = &modules;
+        walk.options = &options;
+        walk.file = file.get();
+        walk.fileLock = &fileLock;
+        walk.found = &found;
+        walk.offsets.resize(options.max_depth);
+    }
+
+    // every holder of the target starts its own task, the walks below it stay on one lane
+    const PointerRef* first;
+    uint64_t low = (target > options.max_offset) ? target - options.max_offset : 0;
+    size_t count = pointerMap_->Find(low, target, &first);
+
+    pool->Run(count, [&](size_t task, size_t worker)
+    {
+        PointerWalk& walk = walks[worker];
+
+        if (!walk.Done())
+        {
+            walk.Follow(first[task], target, 0);
+        }
+    });
+
+    for (auto& walk : walks)
+    {
+        walk.Flush();
+    }
+
+    if (ferror(file.get()) || fflush(file.get()) != 0)
+    {
+        SetError(CGPErrorCode::Invalid_State, "write : ScanPointerPaths");
+    }
+
+    uint64_t paths = found.load();
+    return (options.max_results != 0) ? std::min(paths, options.max_results) : paths;
+}
+
+bool CGPMemoryEngine::SearchByAddress(uint64_t address, const void* target, size_t len)
+{
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    if (!target || len == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "target || len : SearchByAddress");
+        return false;
+    }
+
+    // no heap round trip for the usual value sizes
+    uint8_t local[64];
+    std::vector<uint8_t> large;
+    uint8_t* value = local;
+
+    if (len > sizeof(local))
+    {
+        large.resize(len);
+        value = large.data();
+    }
+
+    if (!ReadThrough(address, value, len))
+    { // Error description backend_->LastStatus()
+        SetError(CGPErrorCode::VMRead_Fail, "Failed to ReadMemory");
+        return false;
+    }
+
+    return (memcmp(value, target, len) == 0);
+}
+
+std::unique_ptr< std::vector<uint8_t> > CGPMemoryEngine::ReadMemory(uint64_t address, size_t len) const
+{
+    if (!IsValid())
+    {
+        return nullptr;
+    }
+
+    if (len == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "len == 0 : ReadMemory");
+        return nullptr;
+    }
+
+    auto buffer = std::make_unique< std::vector<uint8_t> >(len);
+
+    if (!ReadThrough(address, buffer->data(), len))
+    { // Error description backend_->LastStatus()
+        SetError(CGPErrorCode::VMRead_Fail, "Failed to ReadMemory");
+        return nullptr;
+    }
+
+    return buffer;
+}
+
+/* Small reads go through the page cache when there is one, large ones would only flush it */
+bool CGPMemoryEngine::ReadThrough(uint64_t address, void* out, size_t len) const
+{
+    if (pageCache_ && len <= pageCache_->Capacity() / 2)
+    {
+        DropFrozenWrites();
+        return pageCache_->Read(*backend_, address, out, len);
+    }
+
+    return backend_->Read(address, out, len);
+}
+
+/* The freezer writes past the cache, the pages it wrote since the last read drop out here */
+void CGPMemoryEngine::DropFrozenWrites() const
+{
+    std::vector<AddrRange> written;
+
+    if (!freezer_ || !freezer_->TakeWritten(written))
+    {
+        return;
+    }
+
+    for (const auto& range : written)
+    {
+        pageCache_->Invalidate(range.start, static_cast<size_t>(range.end - range.start));
+    }
+}
+
+void CGPMemoryEngine::SetPageCache(size_t bytes)
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    if (bytes == 0)
+    {
+        pageCache_.reset();
+        return;
+    }
+
+    pageCache_ = std::make_unique<CGPPageCache>(pageSize_, bytes);
+}
+
+void CGPMemoryEngine::InvalidatePageCache()
+{
+    if (pageCache_)
+    {
+        pageCache_->NextEpoch();
+    }
+}
+
+uint64_t CGPMemoryEngine::FreezeValue(uint64_t address, const void* data, size_t len, uint32_t intervalMs)
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    if (!data || len == 0 || intervalMs == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "data || len || intervalMs : FreezeValue");
+        return 0;
+    }
+
+    if (!freezer_)
+    {
+        freezer_ = std::make_unique<CGPFreezer>(*backend_);
+    }
+
+    if (pageCache_)
+    {
+        pageCache_->Invalidate(address, len);
+    }
+
+    return freezer_->Add(address, data, len, intervalMs);
+}
+
+void CGPMemoryEngine::UnfreezeValue(uint64_t id)
+{
+    if (freezer_)
+    {
+        freezer_->Remove(id);
+    }
+}
+
+void CGPMemoryEngine::UnfreezeAll()
+{
+    if (freezer_)
+    {
+        freezer_->Clear();
+    }
+}
+
+FreezeStats CGPMemoryEngine::GetFreezerStats() const
+{
+    return freezer_ ? freezer_->Stats() : FreezeStats{ 0, 0, 0, 0 };
+}
+
+uint32_t CGPMemoryEngine::AddWatch(uint64_t address, size_t size, size_t width, uint32_t minIntervalMs, uint32_t maxIntervalMs)
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    if (size == 0 || (width != 1 && width != 2 && width != 4 && width != 8) || size % width != 0 || minIntervalMs == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "size || width || minIntervalMs : AddWatch");
+        return 0;
+    }
+
+    if (!watcher_)
+    {
+        watcher_ = std::make_unique<CGPWatcher>(*backend_);
+    }
+
+    return watcher_->Add(address, size, width, minIntervalMs, maxIntervalMs);
+}
+
+void CGPMemoryEngine::RemoveWatch(uint32_t id)
+{
+    if (watcher_)
+    {
+        watcher_->Remove(id);
+    }
+}
+
+void CGPMemoryEngine::SetWatchCallback(WatchCallback callback)
+{
+    if (!IsValid())
+    {
+        return;
+    }
+
+    if (!watcher_)
+    {
+        watcher_ = std::make_unique<CGPWatcher>(*backend_);
+    }
+
+    watcher_->SetCallback(std::move(callback));
+}
+
+size_t CGPMemoryEngine::PollWatchChanges(WatchChange* out, size_t max)
+{
+    if (!watcher_ || !out)
+    {
+        return 0;
+    }
+
+    return watcher_->Poll(out, max);
+}
+
+size_t CGPMemoryEngine::ReadBatch(ReadRequest* requests, size_t count)
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    if (!requests && count != 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "requests : ReadBatch");
+        return 0;
+    }
+
+    readOrder_.clear();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        requests[i].ok = false;
+
+        if (requests[i].dst && requests[i].len != 0)
+        {
+            readOrder_.push_back(i);
+        }
+    }
+
+    auto byAddress = [requests](size_t a, size_t b)
+    {
+        return requests[a].address < requests[b].address;
+    };
+
+    // field lists are usually declared in address order already
+    if (!std::is_sorted(readOrder_.begin(), readOrder_.end(), byAddress))
+    {
+        std::sort(readOrder_.begin(), readOrder_.end(), byAddress);
+    }
+
+    readOps_.clear();
+    readGroupEnds_.clear();
+    readRetries_.clear();
+
+    size_t staging = 0;
+
+    // near requests share one read, lone ones land straight in dst
+    for (size_t i = 0; i < readOrder_.size();)
+    {
+        const ReadRequest& head = requests[readOrder_[i]];
+        uint64_t start = head.address;
+        uint64_t end = head.address + head.len;
+        size_t last = i + 1;
+
+        while (last < readOrder_.size())
+        {
+            const ReadRequest& next = requests[readOrder_[last]];
+
+            if (next.address > end + CGP_Read_Merge_Gap || std::max(end, next.address + next.len) - start > scanChunkSize_)
+            {
+                break;
+            }
+
+            end = std::max(end, next.address + next.len);
+            ++last;
+        }
+
+        if (last == i + 1)
+        {
+            readOps_.push_back({ start, head.dst, head.len, 0 });
+        }
+        else
+        {
+            readOps_.push_back({ start, nullptr, static_cast<size_t>(end - start), 0 });
+            staging += static_cast<size_t>(end - start);
+        }
+
+        readGroupEnds_.push_back(last);
+        i = last;
+    }
+
+    if (readStaging_.size() < staging)
+    {
+        readStaging_.resize(staging);
+    }
+
+    staging = 0;
+
+    for (RemoteIO& op : readOps_)
+    {
+        if (!op.buffer)
+        {
+            op.buffer = readStaging_.data() + staging;
+            staging += op.len;
+        }
+    }
+
+    backend_->ReadBatch(readOps_.data(), readOps_.size());
+
+    size_t completed = 0;
+    size_t first = 0;
+
+    for (size_t op = 0; op < readOps_.size(); first = readGroupEnds_[op++])
+    {
+        const RemoteIO& io = readOps_[op];
+        bool merged = readGroupEnds_[op] - first > 1;
+
+        for (size_t k = first; k < readGroupEnds_[op]; ++k)
+        {
+            ReadRequest& request = requests[readOrder_[k]];
+            size_t offset = static_cast<size_t>(request.address - io.address);
+
+            if (io.transferred >= offset + request.len)
+            {
+                if (merged)
+                {
+                    memcpy(request.dst, static_cast<const uint8_t*>(io.buffer) + offset, request.len);
+                }
+
+                request.ok = true;
+                ++completed;
+            }
+            else if (merged)
+            { // the shared read stopped at an unmapped gap, the rest go alone
+                readRetries_.push_back(readOrder_[k]);
+            }
+        }
+    }
+
+    if (!readRetries_.empty())
+    {
+        readOps_.clear();
+
+        for (size_t index : readRetries_)
+        {
+            readOps_.push_back({ requests[index].address, requests[index].dst, requests[index].len, 0 });
+        }
+
+        backend_->ReadBatch(readOps_.data(), readOps_.size());
+
+        for (size_t i = 0; i < readRetries_.size(); ++i)
+        {
+            if (readOps_[i].transferred == readOps_[i].len)
+            {
+                requests[readRetries_[i]].ok = true;
+                ++completed;
+            }
+        }
+    }
+
+    return completed;
+}
+
+bool CGPMemoryEngine::WriteMemory(uint64_t address, const void* data, size_t len)
+{
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    if (!data || len == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "data || len : WriteMemory");
+        return false;
+    }
+
+    // even a failed write may have landed in part
+    if (pageCache_)
+    {
+        pageCache_->Invalidate(address, len);
+    }
+
+    if (!backend_->Write(address, data, len))
+    { // Error description backend_->LastStatus()
+        SetError(CGPErrorCode::VMWrite_Fail, "Failed to WriteMemory");
+        return false;
+    }
+
+    return true;
+}
+
+ResultView CGPMemoryEngine::CurrentResults() const
+{
+    return resultFile_ ? resultFile_->View() : result_->View();
+}
+
+void CGPMemoryEngine::ResetResults()
+{
+    result_->Clear();
+    resultFile_.reset();
+    snapshotAll_ = false;
+}
+
+/* Before results are appended to, the mapped hits are copied in under them */
+void CGPMemoryEngine::DetachResultFile()
+{
+    if (resultFile_)
+    {
+        result_->Clear();
+        result_->AppendResult(resultFile_->View());
+        resultFile_.reset();
+    }
+}
+
+bool CGPMemoryEngine::SaveResults(const std::string& path) const
+{
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    TargetIdentity identity;
+    backend_->Identity(identity);
+
+    return CGPResultFile::Save(path, CurrentResults(), identity);
+}
+
+bool CGPMemoryEngine::LoadResults(const std::string& path, bool anyTarget)
+{
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    auto file = std::make_unique<CGPResultFile>(path);
+
+    if (!file->IsOpen())
+    {
+        return false;
+    }
+
+    TargetIdentity identity;
+    backend_->Identity(identity);
+
+    if (!anyTarget && (file->Identity().pid != identity.pid || file->Identity().start_time != identity.start_time))
+    { // addresses of another process, or of an earlier run of this pid
+        return false;
+    }
+
+    result_->Clear();
+    snapshot_.reset();
+    snapshotAll_ = false;
+    resultFile_ = std::move(file);
+
+    return true;
+}
+
+std::vector<void*> CGPMemoryEngine::GetAllResults() const
+{
+    if (!IsValid())
+    {
+        return {};
+    }
+
+    std::vector<void*> addresses;
+    ResultView results = CurrentResults();
+    addresses.reserve(results.count);
+
+    results.ForEach([&](uint64_t address)
+    {
+        addresses.emplace_back(reinterpret_cast<void*>(static_cast<uintptr_t>(address)));
+        return true;
+    });
+
+    return addresses;
+}
+
+std::vector<void*> CGPMemoryEngine::GetResults(int count) const
+{
+    if (!IsValid())
+    {
+        return {};
+    }
+
+    std::vector<void*> addresses;
+
+    if (count <= 0)
+    {
+        return addresses;
+    }
+
+    ResultView results = CurrentResults();
+    size_t actualCount = std::min(static_cast<size_t>(count), results.count);
+    addresses.reserve(actualCount);
+
+    results.ForEach([&](uint64_t address)
+    {
+        addresses.emplace_back(reinterpret_cast<void*>(static_cast<uintptr_t>(address)));
+        return addresses.size() < actualCount;
+    });
+
+    return addresses;
+}
+
+size_t CGPMemoryEngine::GetResultCount() const
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    return CurrentResults().count;
+}
+
+std::vector<void*> CGPMemoryEngine::GetResults(size_t offset, size_t count) const
+{
+    if (!IsValid())
+    {
+        return {};
+    }
+
+    CGPResultRange range(CurrentResults());
+    std::vector<void*> addresses;
+
+    if (offset >= range.size())
+    {
+        return addresses;
+    }
+
+    count = std::min(count, range.size() - offset);
+    addresses.reserve(count);
+
+    auto it = range.begin() + static_cast<ptrdiff_t>(offset);
+
+    for (size_t i = 0; i < count; ++i, ++it)
+    {
+        addresses.emplace_back(reinterpret_cast<void*>(static_cast<uintptr_t>(*it)));
+    }
+
+    return addresses;
+}
+
+CGPResultRange CGPMemoryEngine::GetResultRange() const
+{
+    if (!IsValid())
+    {
+        return CGPResultRange(ResultView());
+    }
+
+    return CGPResultRange(CurrentResults());
+}
+
+bool CGPMemoryEngine::FindResults(const std::string& name, ResultView& view) const
+{
+    if (name.empty())
+    {
+        if (snapshotAll_)
+        { // every aligned value is still a candidate, there are no hits to work with
+            return false;
+        }
+
+        view = CurrentResults();
+        return true;
+    }
+
+    auto it = resultSets_.find(name);
+
+    if (it == resultSets_.end())
+    {
+        return false;
+    }
+
+    view = it->second.View();
+    return true;
+}
+
+void CGPMemoryEngine::PutResults(const std::string& name, Result&& result)
+{
+    if (!name.empty())
+    {
+        resultSets_[name] = std::move(result);
+        return;
+    }
+
+    // the snapshot stays, hits it holds no page for drop out of the next RefineSnapshot
+    ResetResults();
+    *result_ = std::move(result);
+}
+
+bool CGPMemoryEngine::StoreResults(const std::string& name)
+{
+    if (name.empty())
+    {
+        return false;
+    }
+
+    return ShiftResults(name, "", 0);
+}
+
+bool CGPMemoryEngine::RestoreResults(const std::string& name)
+{
+    if (name.empty())
+    {
+        return false;
+    }
+
+    return ShiftResults("", name, 0);
+}
+
+void CGPMemoryEngine::DropResults(const std::string& name)
+{
+    resultSets_.erase(name);
+}
+
+std::vector<std::string> CGPMemoryEngine::GetResultSetNames() const
+{
+    std::vector<std::string> names;
+    names.reserve(resultSets_.size());
+
+    for (const auto& set : resultSets_)
+    {
+        names.push_back(set.first);
+    }
+
+    return names;
+}
+
+size_t CGPMemoryEngine::GetResultCount(const std::string& name) const
+{
+    ResultView view;
+
+    if (!IsValid() || !FindResults(name, view))
+    {
+        return 0;
+    }
+
+    return view.count;
+}
+
+bool CGPMemoryEngine::CombineResults(const std::string& target, const std::string& a, CGPResultSetOp op, const std::string& b)
+{
+    if (!IsValid())
+    {
+        return false;
     }
 
-    kern_return_t kr = vm_deallocate(task_, reinterpret_cast<mach_vm_address_t>(address), size);
-    if (kr != KERN_SUCCESS)
-    { // Error description mach_error_string(kr)
+    ResultView left;
+    ResultView right;
+
+    if (!FindResults(a, left) || !FindResults(b, right))
+    {
+        return false;
+    }
+
+    // built aside, target may be a or b
+    Result combined;
+    CGPResultSet::Combine(left, right, op, combined, ThreadPool());
+    PutResults(target, std::move(combined));
+
+    return true;
+}
+
+bool CGPMemoryEngine::ShiftResults(const std::string& target, const std::string& source, int64_t delta)
+{
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    ResultView view;
+
+    if (!FindResults(source, view))
+    {
+        return false;
+    }
+
+    Result shifted;
+    CGPResultSet::Shift(view, delta, shifted);
+    PutResults(target, std::move(shifted));
+
+    return true;
+}
+
+void* CGPMemoryEngine::AllocateMemory(size_t size)
+{
+    if (!IsValid())
+    {
+        return nullptr;
+    }
+
+    if (size == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "size == 0 : AllocateMemory");
+        return nullptr;
+    }
+
+    uint64_t address = backend_->Allocate(size);
+
+    if (address == 0)
+    { // Error description backend_->LastStatus()
+        SetError(CGPErrorCode::Allocation_Fail, "Failed to AllocateMemory");
+        return nullptr;
+    }
+
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(address));
+}
+
+bool CGPMemoryEngine::DeallocateMemory(void* address, size_t size)
+{
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    if (!address || size == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "address || size : DeallocateMemory");
+        return false;
+    }
+
+    if (pageCache_)
+    {
+        pageCache_->Invalidate(reinterpret_cast<uintptr_t>(address), size);
+    }
+
+    if (!backend_->Deallocate(reinterpret_cast<uintptr_t>(address), size))
+    { // Error description backend_->LastStatus()
         SetError(CGPErrorCode::VMDeallocate_Fail, "Failed to DeallocateMemory");
         return false;
     }
 
-    return true;
+    return true;
+}
+
+#if defined(__APPLE__)
+kern_return_t CGPMemoryEngine::ProtectMemory(void* address, size_t size, vm_prot_t protection)
+{
+    if (!IsValid())
+    {
+        return KERN_INVALID_ARGUMENT;
+    }
+
+    if (!address || size == 0)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "address || size : ProtectMemory");
+        return KERN_INVALID_ADDRESS;
+    }
+
+    if (!backend_->Protect(reinterpret_cast<uintptr_t>(address), size, protection))
+    { // Error description mach_error_string(kr)
+        SetError(CGPErrorCode::VMProtect_Fail, "Failed to ProtectMemory");
+    }
+
+    return static_cast<kern_return_t>(backend_->LastStatus());
+}
+
+kern_return_t CGPMemoryEngine::QueryMemory(void* address, vm_size_t* size, vm_prot_t* protection, vm_inherit_t* inheritance) const
+{
+    if (!IsValid())
+    {
+        return KERN_INVALID_ARGUMENT;
+    }
+
+    if (!address || !size || !protection || !inheritance)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "address || size || protection || inheritance : QueryMemory");
+        return KERN_INVALID_ARGUMENT;
+    }
+
+    RegionInfo region;
+
+    if (!backend_->QueryRegion(reinterpret_cast<uintptr_t>(address), region))
+    { // Error description mach_error_string(kr)
+        SetError(CGPErrorCode::VMQuery_Fail, "Failed to QueryMemory");
+        return static_cast<kern_return_t>(backend_->LastStatus());
+    }
+
+    *size = static_cast<vm_size_t>(region.size);
+    *protection = static_cast<vm_prot_t>(region.protection);
+    *inheritance = static_cast<vm_inherit_t>(region.inheritance);
+
+    return KERN_SUCCESS;
+}
+#endif
+
+bool CGPMemoryEngine::QueryRegion(uint64_t address, RegionInfo* region) const
+{
+    if (!IsValid())
+    {
+        return false;
+    }
+
+    if (!region)
+    {
+        SetError(CGPErrorCode::Invalid_Argument, "region : QueryRegion");
+        return false;
+    }
+
+    if (!backend_->QueryRegion(address, *region))
+    { // Error description backend_->LastStatus()
+        SetError(CGPErrorCode::VMQuery_Fail, "Failed to QueryRegion");
+        return false;
+    }
+
+    return true;
+}
+
+#pragma mark - CGPMemoryScanner Implementation -
+
+/* Identity of an image without LC_UUID, a content hash and the size of its segment */
+static void SegmentKey(const uint8_t* data, size_t size, uint8_t key[CGP_SigCache_Key_Size])
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+
+    for (; i < size; ++i)
+    {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+
+    uint64_t length = size;
+
+    memcpy(key, &hash, sizeof(hash));
+    memcpy(key + sizeof(hash), &length, sizeof(length));
+}
+
+#if defined(__APPLE__)
+static bool ImageUUID(const mach_header_64* header, uint8_t key[CGP_SigCache_Key_Size])
+{
+    const uint8_t* command = reinterpret_cast<const uint8_t*>(header + 1);
+
+    for (uint32_t i = 0; i < header->ncmds; ++i)
+    {
+        const load_command* load = reinterpret_cast<const load_command*>(command);
+
+        if (load->cmd == LC_UUID)
+        {
+            memcpy(key, reinterpret_cast<const uuid_command*>(load)->uuid, CGP_SigCache_Key_Size);
+            return true;
+        }
+
+        command += load->cmdsize;
+    }
+
+    return false;
+}
+
+CGPMemoryScanner::CGPMemoryScanner(const std::string& binaryName, const std::string& segmentName)
+    : CGPMemoryEngine(mach_task_self()), ImageBase_(0), SegmentStart_(0), SegmentEnd_(0), segmentData_(nullptr), imageKey_()
+{
+    const struct mach_header_64* header = nullptr;
+
+    uint32_t imageCount = _dyld_image_count();
+
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        const char* imageName = _dyld_get_image_name(i);
+
+        if (strstr(imageName, binaryName.c_str()))
+        {
+            header = reinterpret_cast<const mach_header_64*>(_dyld_get_image_header(i));
+            break;
+        }
+    }
+
+    if (!header)
+    {
+        SetError(CGPErrorCode::Binary_Not_Found, "Binary not found in loaded images");
+        return;
+    }
+
+    unsigned long segmentSize = 0;
+    uintptr_t segmentData = reinterpret_cast<uintptr_t>(getsegmentdata(header, segmentName.c_str(), &segmentSize));
+
+    if (!segmentData)
+    {
+        SetError(CGPErrorCode::Segment_Not_Found, "Segment not found in binary");
+        return;
+    }
+
+    ImageBase_ = reinterpret_cast<uintptr_t>(header);
+    SegmentStart_ = segmentData;
+    SegmentEnd_ = SegmentStart_ + segmentSize;
+    segmentData_ = reinterpret_cast<const uint8_t*>(segmentData);
+
+    if (!ImageUUID(header, imageKey_))
+    {
+        SegmentKey(segmentData_, segmentSize, imageKey_);
+    }
+}
+#else
+CGPMemoryScanner::CGPMemoryScanner(const std::string& binaryName, const std::string& segmentName)
+    : CGPMemoryEngine(getpid()), ImageBase_(0), SegmentStart_(0), SegmentEnd_(0), segmentData_(nullptr), imageKey_()
+{
+    // no dyld image list outside of Apple platforms
+    (void)binaryName;
+    (void)segmentName;
+
+    SetError(CGPErrorCode::Binary_Not_Found, "Binary not found in loaded images");
+}
+#endif
+
+CGPMemoryScanner::CGPMemoryScanner(std::shared_ptr<const CGPMachOFile> image, const std::string& segmentName)
+    : CGPMemoryEngine(std::make_unique<CGPMachOBackend>(image)), ImageBase_(0), SegmentStart_(0), SegmentEnd_(0),
+      segmentData_(nullptr), imageKey_()
+{
+    if (!IsValid())
+    { // backend_ rejected an image that did not open
+        return;
+    }
+
+    const MachOSegment* segment = image->FindSegment(segmentName);
+
+    if (!segment || segment->filesize == 0)
+    {
+        SetError(CGPErrorCode::Segment_Not_Found, "Segment not found in binary");
+        return;
+    }
+
+    ImageBase_ = image->ImageBase();
+    SegmentStart_ = segment->vmaddr;
+    SegmentEnd_ = SegmentStart_ + segment->filesize;
+    segmentData_ = image->Translate(segment->vmaddr, segment->filesize);
+
+    if (!image->UUID(imageKey_))
+    {
+        SegmentKey(segmentData_, segment->filesize, imageKey_);
+    }
+}
+
+uintptr_t CGPMemoryScanner::FindDirectSig(const std::string& signature, int step) const
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    uintptr_t found = FindSigMatch(signature);
+    return (found != 0) ? (found + step) : 0;
+}
+
+uintptr_t CGPMemoryScanner::Find_ADRL_Sig(const std::string& signature, int step) const
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    return ResolveSig(FindDirectSig(signature, step), CGPSigKind::ADRL);
+}
+
+uintptr_t CGPMemoryScanner::Find_ADRP_LDRSTR_Sig(const std::string& signature, int step) const
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    return ResolveSig(FindDirectSig(signature, step), CGPSigKind::ADRP_LDRSTR);
+}
+
+uintptr_t CGPMemoryScanner::Find_LDRSTR_Sig64(const std::string& signature, int step) const
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    return ResolveSig(FindDirectSig(signature, step), CGPSigKind::LDRSTR64);
+}
+
+uintptr_t CGPMemoryScanner::Find_LDRSTR_Sig32(const std::string& signature, int step) const
+{
+    if (!IsValid())
+    {
+        return 0;
+    }
+
+    return ResolveSig(FindDirectSig(signature, step), CGPSigKind::LDRSTR32);
 }
 
-kern_return_t CGPMemoryEngine::ProtectMemory(void* address, size_t size, vm_prot_t protection)
+void CGPMemoryScanner::ResolveSignatures(std::vector<SigEntry>& entries)
 {
-    if (!IsValid())
+    for (SigEntry& entry : entries)
     {
-        return KERN_INVALID_ARGUMENT;
+        entry.result = 0;
     }
 
-    if (!address || size == 0)
+    if (!IsValid())
     {
-        SetError(CGPErrorCode::Invalid_Argument, "address || size : ProtectMemory");
-        return KERN_INVALID_ADDRESS;
+        return;
     }
 
-    kern_return_t kr = vm_protect(task_, reinterpret_cast<vm_address_t>(address), size, FALSE, protection);
-    if (kr != KERN_SUCCESS)
-    { // Error description mach_error_string(kr)
-        SetError(CGPErrorCode::VMProtect_Fail, "Failed to ProtectMemory");
+    if (SegmentStart_ >= SegmentEnd_ || entries.empty())
+    {
+        return;
     }
 
-    return kr;
-}
+    std::vector<CGPPattern> patterns;
+    std::vector<size_t> pending; // entries the cache could not answer
+    patterns.reserve(entries.size());
 
-kern_return_t CGPMemoryEngine::QueryMemory(void* address, vm_size_t* size, vm_prot_t* protection, vm_inherit_t* inheritance) const
-{
-    if (!IsValid())
+    for (size_t i = 0; i < entries.size(); ++i)
     {
-        return KERN_INVALID_ARGUMENT;
-    }
+        CGPPattern pattern(entries[i].signature);
+        uintptr_t found = CachedSigMatch(entries[i].signature, pattern);
 
-    if (!address || !size || !protection || !inheritance)
-    {
-        SetError(CGPErrorCode::Invalid_Argument, "address || size || protection || inheritance : QueryMemory");
-        return KERN_INVALID_ARGUMENT;
-    }
+        if (found != 0)
+        {
+            entries[i].result = ResolveSig(found + entries[i].step, entries[i].kind);
+            continue;
+        }
 
-    vm_address_t addr = reinterpret_cast<vm_address_t>(address);
-    vm_region_basic_info_data_64_t info;
-    mach_msg_type_number_t count = VM_REGION_BASIC_INFO_COUNT_64;
-    memory_object_name_t object;
+        patterns.push_back(std::move(pattern));
+        pending.push_back(i);
+    }
 
-    kern_return_t kr = vm_region_64(task_, &addr, size, VM_REGION_BASIC_INFO_64,
-                                    reinterpret_cast<vm_region_info_t>(&info), &count, &object);
-    if (kr == KERN_SUCCESS)
+    if (pending.empty())
     {
-        *protection = info.protection;
-        *inheritance = info.inheritance;
-    }
-    else
-    { // Error description mach_error_string(kr)
-        SetError(CGPErrorCode::VMQuery_Fail, "Failed to QueryMemory");
+        return;
     }
 
-    return kr;
-}
+    CGPPatternSet set(patterns);
 
-#pragma mark - CGPMemoryScanner Implementation -
+    const uint8_t* data = segmentData_;
+    size_t size = SegmentEnd_ - SegmentStart_;
+    size_t tasks = (size + scanChunkSize_ - 1) / scanChunkSize_;
 
-CGPMemoryScanner::CGPMemoryScanner(const std::string& binaryName, const std::string& segmentName)
-    : CGPMemoryEngine(mach_task_self()), SegmentStart_(0), SegmentEnd_(0)
-{
-    const struct mach_header_64* header = nullptr;
+    CGPThreadPool* pool = ThreadPool();
 
-    uint32_t imageCount = _dyld_image_count();
+    // first hits per lane, a lane that already holds a lower hit skips the pattern in later chunks
+    std::vector< std::vector<size_t> > first(pool->Size(), std::vector<size_t>(patterns.size(), CGPPattern::npos));
 
-    for (uint32_t i = 0; i < imageCount; ++i)
+    pool->Run(tasks, [&](size_t task, size_t worker)
     {
-        const char* imageName = _dyld_get_image_name(i);
+        size_t from = task * scanChunkSize_;
+        set.FindFirst(data, size, from, from + scanChunkSize_, first[worker]);
+    });
 
-        if (strstr(imageName, binaryName.c_str()))
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        SigEntry& entry = entries[pending[i]];
+        size_t offset = CGPPattern::npos;
+
+        for (const std::vector<size_t>& lane : first)
         {
-            header = reinterpret_cast<const mach_header_64*>(_dyld_get_image_header(i));
-            break;
+            offset = std::min(offset, lane[i]);
         }
-    }
 
-    if (!header)
-    {
-        SetError(CGPErrorCode::Binary_Not_Found, "Binary not found in loaded images");
-        return;
-    }
+        if (offset == CGPPattern::npos)
+        {
+            continue;
+        }
 
-    unsigned long segmentSize = 0;
-    uintptr_t segmentData = reinterpret_cast<uintptr_t>(getsegmentdata(header, segmentName.c_str(), &segmentSize));
+        uintptr_t found = SegmentStart_ + offset;
 
-    if (!segmentData)
-    {
-        SetError(CGPErrorCode::Segment_Not_Found, "Segment not found in binary");
-        return;
-    }
+        if (sigCache_)
+        {
+            sigCache_->Store(entry.signature, found - ImageBase_);
+        }
 
-    SegmentStart_ = segmentData;
-    SegmentEnd_ = SegmentStart_ + segmentSize;
+        entry.result = ResolveSig(found + entry.step, entry.kind);
+    }
 }
 
-uintptr_t CGPMemoryScanner::FindDirectSig(const std::string& signature, int step) const
+bool CGPMemoryScanner::SetSignatureCache(const std::string& path)
 {
     if (!IsValid())
     {
-        return 0;
+        return false;
     }
 
-    uintptr_t found = FindIDAPatternFirst(signature);
-    return (found != 0) ? (found + step) : 0;
+    if (path.empty())
+    {
+        sigCache_.reset();
+        return false;
+    }
+
+    sigCache_ = std::make_unique<CGPSigCache>(path, imageKey_);
+    return sigCache_->Load();
 }
 
-uintptr_t CGPMemoryScanner::Find_ADRL_Sig(const std::string& signature, int step) const
+bool CGPMemoryScanner::SaveSignatureCache() const
 {
     if (!IsValid())
     {
-        return 0;
+        return false;
     }
 
-    uintptr_t insnAddress = FindDirectSig(signature, step);
-
-    if (insnAddress == 0)
+    if (!sigCache_)
     {
-        return 0;
+        return false;
     }
 
-    // read ADRP instruction
-    auto adrpRead = ReadMemory(insnAddress, sizeof(uint32_t));
+    return !sigCache_->IsDirty() || sigCache_->Save();
+}
+
+uintptr_t CGPMemoryScanner::CachedSigMatch(const std::string& signature, const CGPPattern& pattern) const
+{
+    uint64_t offset = 0;
 
-    if (!adrpRead || adrpRead->size() != sizeof(uint32_t))
+    if (!sigCache_ || !pattern.IsValid() || !sigCache_->Lookup(signature, &offset))
     {
         return 0;
     }
 
-    uint32_t adrpInsn = *reinterpret_cast<uint32_t*>(adrpRead->data());
-
-    // read ADD instruction
-    auto addRead = ReadMemory(insnAddress + sizeof(uint32_t), sizeof(uint32_t));
+    uintptr_t found = ImageBase_ + offset;
 
-    if (!addRead || addRead->size() != sizeof(uint32_t))
+    // a cached offset only counts while the pattern still matches there
+    if (found < SegmentStart_ || found > SegmentEnd_ || SegmentEnd_ - found < pattern.Size() ||
+        !pattern.Matches(segmentData_ + (found - SegmentStart_)))
     {
+        sigCache_->Erase(signature);
         return 0;
     }
 
-    uint32_t addInsn = *reinterpret_cast<uint32_t*>(addRead->data());
+    return found;
+}
+
+uintptr_t CGPMemoryScanner::FindSigMatch(const std::string& signature) const
+{
+    CGPPattern pattern(signature);
+    uintptr_t found = CachedSigMatch(signature, pattern);
 
-    if (adrpInsn == 0 || addInsn == 0)
+    if (found != 0)
     {
-        return 0;
+        return found;
     }
 
-    int64_t adrpPcRel = 0;
+    found = FindPatternFirst(pattern);
 
-    if (!DecodeADRImmediate(adrpInsn, &adrpPcRel) || adrpPcRel == 0)
+    if (found != 0 && sigCache_)
     {
-        return 0;
+        sigCache_->Store(signature, found - ImageBase_);
     }
 
-    int32_t addImm12 = DecodeAddSubImmediate(addInsn);
-
-    return (GetPageOffset(insnAddress) + adrpPcRel + addImm12);
+    return found;
 }
 
-uintptr_t CGPMemoryScanner::Find_ADRP_LDRSTR_Sig(const std::string& signature, int step) const
+uintptr_t CGPMemoryScanner::ResolveSig(uintptr_t insnAddress, CGPSigKind kind) const
 {
-    if (!IsValid())
-    {
-        return 0;
-    }
-
-    uintptr_t insnAddress = FindDirectSig(signature, step);
-
     if (insnAddress == 0)
     {
         return 0;
     }
 
-    // read ADRP instruction
-    auto adrpRead = ReadMemory(insnAddress, sizeof(uint32_t));
-
-    if (!adrpRead || adrpRead->size() != sizeof(uint32_t))
+    if (kind == CGPSigKind::Direct)
     {
-        return 0;
+        return insnAddress;
     }
 
-    uint32_t adrpInsn = *reinterpret_cast<uint32_t*>(adrpRead->data());
+    // read the first instruction
+    auto firstRead = ReadMemory(insnAddress, sizeof(uint32_t));
 
-    // read LDRSTR instruction
-    auto ldrStrRead = ReadMemory(insnAddress + sizeof(uint32_t), sizeof(uint32_t));
-
-    if (!ldrStrRead || ldrStrRead->size() != sizeof(uint32_t))
+    if (!firstRead || firstRead->size() != sizeof(uint32_t))
     {
         return 0;
     }
 
-    uint32_t ldrStrInsn = *reinterpret_cast<uint32_t*>(ldrStrRead->data());
+    uint32_t firstInsn = *reinterpret_cast<uint32_t*>(firstRead->data());
 
-    if (adrpInsn == 0 || ldrStrInsn == 0)
+    if (firstInsn == 0)
     {
         return 0;
     }
 
-    int64_t adrpPcRel = 0;
-
-    if (!DecodeADRImmediate(adrpInsn, &adrpPcRel) || adrpPcRel == 0)
+    if (kind == CGPSigKind::LDRSTR64 || kind == CGPSigKind::LDRSTR32)
     {
-        return 0;
+        uintptr_t imm12 = (firstInsn >> 10) & 0xFFF;
+
+        return imm12 * 8;
     }
 
-    int32_t ldrStrImm12 = 0;
+    // ADRP followed by ADD or LDR/STR
+    auto secondRead = ReadMemory(insnAddress + sizeof(uint32_t), sizeof(uint32_t));
 
-    if (!DecodeLDRSTRImmediate(ldrStrInsn, &ldrStrImm12))
+    if (!secondRead || secondRead->size() != sizeof(uint32_t))
     {
         return 0;
     }
 
-    return (GetPageOffset(insnAddress) + adrpPcRel + ldrStrImm12);
-}
+    uint32_t secondInsn = *reinterpret_cast<uint32_t*>(secondRead->data());
 
-uintptr_t CGPMemoryScanner::Find_LDRSTR_Sig64(const std::string& signature, int step) const
-{
-    if (!IsValid())
+    if (secondInsn == 0)
     {
         return 0;
     }
 
-    uintptr_t insnAddress = FindDirectSig(signature, step);
+    int64_t adrpPcRel = 0;
 
-    if (insnAddress == 0)
+    if (!DecodeADRImmediate(firstInsn, &adrpPcRel) || adrpPcRel == 0)
     {
         return 0;
     }
 
-    // read LDRSTR instruction
-    auto ldrStrRead = ReadMemory(insnAddress, sizeof(int32_t));
-    if (!ldrStrRead || ldrStrRead->size() != sizeof(int32_t))
+    if (kind == CGPSigKind::ADRL)
     {
-        return 0;
+        int32_t addImm12 = DecodeAddSubImmediate(secondInsn);
+
+        return (GetPageOffset(insnAddress) + adrpPcRel + addImm12);
     }
 
-    int32_t ldrStrInsn = *reinterpret_cast<int32_t*>(ldrStrRead->data());
+    int32_t ldrStrImm12 = 0;
 
-    if (ldrStrInsn == 0)
+    if (!DecodeLDRSTRImmediate(secondInsn, &ldrStrImm12))
     {
         return 0;
     }
 
-    uintptr_t imm12 = (ldrStrInsn >> 10) & 0xFFF;
-
-    return imm12 * 8;
+    return (GetPageOffset(insnAddress) + adrpPcRel + ldrStrImm12);
 }
 
-uintptr_t CGPMemoryScanner::Find_LDRSTR_Sig32(const std::string& signature, int step) const
+std::vector<uintptr_t> CGPMemoryScanner::FindBytesAll(const std::vector<char>& bytes, const std::string& mask) const
 {
     if (!IsValid())
     {
-        return 0;
+        return {};
     }
 
-    uintptr_t insnAddress = FindDirectSig(signature, step);
-
-    if (insnAddress == 0)
+    if (bytes.empty() || bytes.size() != mask.size())
     {
-        return 0;
+        return {};
     }
 
-    // read LDRSTR instruction
-    auto ldrStrRead = ReadMemory(insnAddress, sizeof(int32_t));
-    if (!ldrStrRead || ldrStrRead->size() != sizeof(int32_t))
+    return FindPatternAll(CGPPattern(bytes, mask));
+}
+
+uintptr_t CGPMemoryScanner::FindBytesFirst(const std::vector<char>& bytes, const std::string& mask) const
+{
+    if (!IsValid())
     {
         return 0;
     }
 
-    int32_t ldrStrInsn = *reinterpret_cast<int32_t*>(ldrStrRead->data());
-
-    if (ldrStrInsn == 0)
+    if (bytes.empty() || bytes.size() != mask.size())
     {
         return 0;
     }
 
-    uint32_t imm12 = (ldrStrInsn >> 10) & 0xFFF;
-
-    return imm12 * 8;
+    return FindPatternFirst(CGPPattern(bytes, mask));
 }
 
-bool CGPMemoryScanner::ComparePattern(const char* data, const char* pattern, const char* mask) const
+std::vector<uintptr_t> CGPMemoryScanner::FindIDAPatternAll(const std::string& pattern) const
 {
-    while (*mask)
+    if (!IsValid())
     {
-        if (*mask == 'x' && *data != *pattern)
-        {
-            return false;
-        }
-
-        ++data;
-        ++pattern;
-        ++mask;
+        return {};
     }
-    return true;
+
+    return FindPatternAll(CGPPattern(pattern));
 }
 
-uintptr_t CGPMemoryScanner::SearchInRange(uintptr_t start, const char* pattern, const std::string& mask) const
+uintptr_t CGPMemoryScanner::FindIDAPatternFirst(const std::string& pattern) const
 {
-    size_t scanSize = mask.length();
-
-    if (scanSize < 1 || (start + scanSize) > SegmentEnd_)
+    if (!IsValid())
     {
         return 0;
     }
 
-    size_t length = SegmentEnd_ - start;
-
-    for (size_t i = 0; i <= length - scanSize; ++i)
-    {
-        uintptr_t currentAddress = start + i;
-
-        if (ComparePattern(reinterpret_cast<const char*>(currentAddress), pattern, mask.c_str()))
-        {
-            return currentAddress;
-        }
-    }
-
-    return 0;
+    return FindPatternFirst(CGPPattern(pattern));
 }
 
-std::vector<uintptr_t> CGPMemoryScanner::FindBytesAll(const std::vector<char>& bytes, const std::string& mask) const
+std::vector<uintptr_t> CGPMemoryScanner::FindPatternAll(const CGPPattern& pattern) const
 {
     if (!IsValid())
     {
@@ -637,162 +3050,204 @@ std::vector<uintptr_t> CGPMemoryScanner::FindBytesAll(const std::vector<char>& b
 
     std::vector<uintptr_t> results;
 
-    if (SegmentStart_ >= SegmentEnd_ || bytes.empty() || mask.empty())
+    if (SegmentStart_ >= SegmentEnd_ || !pattern.IsValid())
     {
         return results;
     }
 
-    if (bytes.size() != mask.size())
-    {
-        return results;
-    }
+    std::vector<size_t> hits;
+    pattern.FindAll(segmentData_, SegmentEnd_ - SegmentStart_, hits);
 
-    uintptr_t currentSearchAddress = SegmentStart_;
-    size_t scanSize = mask.length();
+    results.reserve(hits.size());
 
-    while (currentSearchAddress + scanSize <= SegmentEnd_)
+    for (size_t offset : hits)
     {
-        uintptr_t found = SearchInRange(currentSearchAddress, bytes.data(), mask);
-
-        if (found == 0) 
-        {
-            break;
-        }
-
-        results.emplace_back(found);
-        currentSearchAddress = found + scanSize;
+        results.emplace_back(SegmentStart_ + offset);
     }
 
     return results;
 }
 
-uintptr_t CGPMemoryScanner::FindBytesFirst(const std::vector<char>& bytes, const std::string& mask) const
+uintptr_t CGPMemoryScanner::FindPatternFirst(const CGPPattern& pattern) const
 {
     if (!IsValid())
     {
         return 0;
     }
 
-    if (SegmentStart_ >= SegmentEnd_ || bytes.empty() || mask.empty())
+    if (SegmentStart_ >= SegmentEnd_ || !pattern.IsValid())
     {
         return 0;
     }
 
-    if (bytes.size() != mask.size())
-    {
-        return 0;
-    }
+    size_t offset = pattern.FindFirst(segmentData_, SegmentEnd_ - SegmentStart_);
 
-    return SearchInRange(SegmentStart_, bytes.data(), mask);
+    return (offset != CGPPattern::npos) ? (SegmentStart_ + offset) : 0;
 }
 
-std::vector<uintptr_t> CGPMemoryScanner::FindIDAPatternAll(const std::string& pattern) const
+uintptr_t CGPMemoryScanner::GetPageOffset(uintptr_t address) const
 {
-    if (!IsValid())
-    {
-        return {};
-    }
+    // ADRP works on 4K pages whatever the OS page size is
+    return address & ~static_cast<uintptr_t>(0xFFF);
+}
 
-    std::vector<uintptr_t> results;
+/* [first, last) are segment offsets of the ADR/ADRP candidates, a pair may read past last */
+void CGPMemoryScanner::DecodeXrefs(size_t first, size_t last, std::vector<XrefEntry>& out) const
+{
+    size_t size = SegmentEnd_ - SegmentStart_;
 
-    if (SegmentStart_ >= SegmentEnd_)
+    for (size_t offset = first; offset < last && offset + sizeof(uint32_t) <= size; offset += sizeof(uint32_t))
     {
-        return results;
-    }
+        uint32_t insn;
+        memcpy(&insn, segmentData_ + offset, sizeof(insn));
 
-    std::string mask;
-    std::vector<char> bytes;
+        int64_t imm = 0;
 
-    size_t patternLen = pattern.length();
-
-    for (size_t i = 0; i < patternLen; ++i)
-    {
-        if (pattern[i] == ' ')
+        if (!DecodeADRImmediate(insn, &imm))
         {
             continue;
         }
 
-        if (pattern[i] == '?')
-        {
-            bytes.push_back(0);
-            mask += '?';
-        }
-        else if (std::isxdigit(pattern[i]) && (i + 1) < patternLen && std::isxdigit(pattern[i + 1]))
+        uint64_t pc = SegmentStart_ + offset;
+
+        if (IsADR(insn))
         {
-            std::string byteStr = pattern.substr(i, 2);
-            bytes.push_back(static_cast<char>(std::stoi(byteStr, nullptr, 16)));
-            mask += 'x';
-            ++i; // skip next character
+            out.push_back({ pc + imm, pc });
+            continue;
         }
-        else
+
+        uint64_t page = GetPageOffset(pc) + imm;
+        uint32_t base = insn & 0x1F;
+
+        for (size_t k = 1; k <= CGP_Xref_Window; ++k)
         {
-            // invalid pattern character
-            return results;
+            size_t next = offset + k * sizeof(uint32_t);
+
+            if (next + sizeof(uint32_t) > size)
+            {
+                break;
+            }
+
+            uint32_t use;
+            memcpy(&use, segmentData_ + next, sizeof(use));
+
+            uint32_t rn = (use >> 5) & 0x1F;
+            uint32_t rd = use & 0x1F;
+            int32_t ldrStrImm12 = 0;
+
+            if (IsADRP(use) && rd == base)
+            {
+                break; // base register reloaded
+            }
+
+            if (IsAddImmediate64(use) && rn == base)
+            {
+                out.push_back({ page + DecodeAddSubImmediate(use), pc + k * sizeof(uint32_t) });
+
+                if (rd == base)
+                {
+                    break;
+                }
+            }
+            else if (rn == base && DecodeLDRSTRImmediate(use, &ldrStrImm12))
+            {
+                out.push_back({ page + ldrStrImm12, pc + k * sizeof(uint32_t) });
+
+                // a load into the base register ends the pair
+                if ((use & (1u << 22)) && rd == base)
+                {
+                    break;
+                }
+            }
         }
     }
+}
 
-    if (bytes.empty() || mask.empty() || bytes.size() != mask.size())
+bool CGPMemoryScanner::BuildXrefIndex()
+{
+    if (!IsValid())
     {
-        return results;
+        return false;
     }
 
-    return FindBytesAll(bytes, mask);
-}
+    xrefs_.clear();
 
-uintptr_t CGPMemoryScanner::FindIDAPatternFirst(const std::string& pattern) const
-{
-    if (!IsValid())
+    if (SegmentStart_ >= SegmentEnd_ || !segmentData_)
     {
-        return 0;
+        SetError(CGPErrorCode::Invalid_State, "segmentData_ : BuildXrefIndex");
+        return false;
     }
 
-    if (SegmentStart_ >= SegmentEnd_)
+    size_t size = SegmentEnd_ - SegmentStart_;
+    size_t first = (sizeof(uint32_t) - SegmentStart_ % sizeof(uint32_t)) % sizeof(uint32_t); // instructions are 4-byte aligned
+    size_t chunk = scanChunkSize_; // whole pages, so chunks stay 4-byte aligned
+    size_t tasks = (size > first) ? (size - first + chunk - 1) / chunk : 0;
+
+    CGPThreadPool* pool = ThreadPool();
+
+    std::vector< std::vector<XrefEntry> > partial(tasks);
+
+    pool->Run(tasks, [&](size_t task, size_t)
     {
-        return 0;
+        size_t begin = first + task * chunk;
+        DecodeXrefs(begin, std::min(size, begin + chunk), partial[task]);
+    });
+
+    size_t total = 0;
+
+    for (const std::vector<XrefEntry>& part : partial)
+    {
+        total += part.size();
     }
 
-    std::string mask;
-    std::vector<char> bytes;
+    xrefs_.reserve(total);
 
-    size_t patternLen = pattern.length();
+    for (const std::vector<XrefEntry>& part : partial)
+    {
+        xrefs_.insert(xrefs_.end(), part.begin(), part.end());
+    }
 
-    for (size_t i = 0; i < patternLen; ++i)
+    std::sort(xrefs_.begin(), xrefs_.end(), [](const XrefEntry& a, const XrefEntry& b)
     {
-        if (pattern[i] == ' ')
-        {
-            continue;
-        }
+        return a.target != b.target ? a.target < b.target : a.from < b.from;
+    });
 
-        if (pattern[i] == '?')
-        {
-            bytes.push_back(0);
-            mask += '?';
-        }
-        else if (std::isxdigit(pattern[i]) && (i + 1) < patternLen && std::isxdigit(pattern[i + 1]))
-        {
-            std::string byteStr = pattern.substr(i, 2);
-            bytes.push_back(static_cast<char>(std::stoi(byteStr, nullptr, 16)));
-            mask += 'x';
-            ++i; // skip next character
-        }
-        else
-        {
-            // invalid pattern character
-            return 0;
-        }
+    return true;
+}
+
+std::vector<uint64_t> CGPMemoryScanner::FindXrefs(uint64_t target) const
+{
+    std::vector<uint64_t> from;
+
+    if (!IsValid())
+    {
+        return from;
     }
 
-    if (bytes.empty() || mask.empty() || bytes.size() != mask.size())
+    for (const XrefEntry& entry : FindXrefs(target, target + 1))
     {
-        return 0;
+        from.push_back(entry.from);
     }
 
-    return FindBytesFirst(bytes, mask);
+    return from;
 }
 
-uintptr_t CGPMemoryScanner::GetPageOffset(uintptr_t address) const
+std::vector<XrefEntry> CGPMemoryScanner::FindXrefs(uint64_t start, uint64_t end) const
 {
-    return address & ~(pageSize_ - 1);
+    if (!IsValid())
+    {
+        return {};
+    }
+
+    auto below = [](const XrefEntry& entry, uint64_t address)
+    {
+        return entry.target < address;
+    };
+
+    auto lower = std::lower_bound(xrefs_.begin(), xrefs_.end(), start, below);
+    auto upper = std::lower_bound(lower, xrefs_.end(), end, below);
+
+    return std::vector<XrefEntry>(lower, upper);
 }
 
 #pragma mark - CGPInstructionDecoder Implementation -
@@ -822,6 +3277,12 @@ bool CGPInstructionDecoder::IsLDR(uint32_t insn) const
     return GetBit(insn, 22) == 1;
 }
 
+/* ADD Xd, Xn, #imm{, LSL #12} */
+bool CGPInstructionDecoder::IsAddImmediate64(uint32_t insn) const
+{
+    return (insn & 0xFF800000) == 0x91000000;
+}
+
 bool CGPInstructionDecoder::IsLDRSTU(uint32_t insn) const
 {
     return (insn & 0x0A000000) == 0x08000000;
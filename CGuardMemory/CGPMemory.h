@@ -9,11 +9,13 @@
 #ifndef CGPMemory_h
 #define CGPMemory_h
 
+#if defined(__APPLE__)
 #include <mach-o/dyld.h>
 #include <mach/mach.h>
 #include <mach-o/loader.h>
 #include <mach-o/nlist.h>
 #include <mach-o/getsect.h>
+#endif
 
 #include <cstdio>
 #include <algorithm>
@@ -22,12 +24,29 @@
 #include <sys/mman.h>
 #include <vector>
 #include <memory>
+#include <new>
 #include <cctype>
 #include <cstring>
+#include <map>
 
 #include "CGPError.h"
+#include "CGPBackend.h"
+#include "CGPFreezer.h"
+#include "CGPPageCache.h"
+#include "CGPPattern.h"
+#include "CGPPointerMap.h"
+#include "CGPResult.h"
+#include "CGPResultFile.h"
+#include "CGPResultSet.h"
+#include "CGPScanKernel.h"
+#include "CGPSigCache.h"
+#include "CGPSnapshot.h"
+#include "CGPThreadPool.h"
+#include "CGPWatcher.h"
 
+#if defined(__APPLE__)
 #include <libkern/OSCacheControl.h>
+#endif
 
 #define CGP_Type_ULong 8
 #define CGP_Type_Double 8
@@ -40,26 +59,85 @@
 #define CGP_Type_UByte 1
 #define CGP_Type_SByte 1
 
-typedef struct _result_region {
-    mach_vm_address_t region_base;
-    std::vector<uint32_t> slide;
-} ResultRegion;
+/* Default ScanMemory chunk, larger regions are streamed through it, smaller ones share a batched read */
+#define CGP_Scan_Chunk_Size (2 * 1024 * 1024)
 
-typedef struct _result {
-    std::vector< std::unique_ptr<ResultRegion> > resultBuffer;
-    int count = 0;
-} Result;
+/* Hits decoded per RefineResults pass */
+#define CGP_Refine_Batch_Hits (1u << 20)
 
-typedef struct _addr_range {
-    uint64_t start;
-    uint64_t end;
-} AddrRange;
+/* Chunks spread across a GroupSearch range that are sampled to pick the rarest value, and bytes read from each */
+#define CGP_Group_Sample_Chunks 8
+#define CGP_Group_Sample_Bytes (64 * 1024)
+
+/* ReadBatch requests at most this many bytes apart share one read */
+#define CGP_Read_Merge_Gap 4096
+
+/* One ReadBatch field, dst receives len bytes when ok */
+typedef struct _read_request {
+    uint64_t address;
+    size_t len;
+    void* dst;
+    bool ok;
+} ReadRequest;
 
 typedef struct _image_ptr {
     std::vector<uint64_t> base;
     std::vector<uint64_t> end;
 } ImagePtr;
 
+/* Static base of a pointer path, paths start at a holder in [start, end) */
+typedef struct _pointer_module {
+    std::string name;
+    uint64_t start;
+    uint64_t end;
+} PointerModule;
+
+typedef struct _pointer_scan_options {
+    size_t max_depth = 5;           // dereferences per path
+    uint64_t max_offset = 0x1000;   // largest offset added after a dereference
+    uint64_t max_results = 0;       // 0 = every path
+    std::vector<PointerModule> modules; // empty = modules guessed from the map's file backed regions
+} PointerScanOptions;
+
+/* One GroupSearch value, stored in the low CGPValueSize(type) bytes of bits */
+typedef struct _group_value {
+    CGPValueType type;
+    uint64_t bits;
+
+    template <typename T>
+    static _group_value Make(CGPValueType type, T value)
+    {
+        _group_value group = { type, 0 };
+        memcpy(&group.bits, &value, std::min(sizeof(T), sizeof(group.bits)));
+        return group;
+    }
+} GroupValue;
+
+/* Resolver applied to a signature hit, one per Find*Sig shortcut */
+enum class CGPSigKind {
+    Direct,
+    ADRL,
+    ADRP_LDRSTR,
+    LDRSTR64,
+    LDRSTR32,
+};
+
+typedef struct _sig_entry {
+    std::string signature;
+    CGPSigKind kind;
+    int step;
+    uintptr_t result;   // 0 when not found, as with the shortcuts
+} SigEntry;
+
+/* One data reference, from is the ADR or the ADD/LDR/STR completing an ADRP pair */
+typedef struct _xref_entry {
+    uint64_t target;
+    uint64_t from;
+} XrefEntry;
+
+/* Instructions after an ADRP searched for the ADD/LDR/STR using its register */
+#define CGP_Xref_Window 4
+
 /* Instruction Decoder Class */
 class CGPInstructionDecoder {
 public:
@@ -67,12 +145,14 @@ public:
     bool DecodeLDRSTRImmediate(uint32_t insn, int32_t* imm12) const;
     int32_t DecodeAddSubImmediate(uint32_t insn) const;
 
+    bool IsADR(uint32_t insn) const;
+    bool IsADRP(uint32_t insn) const;
+    bool IsAddImmediate64(uint32_t insn) const;
+
 private:
     int32_t GetBit(uint32_t insn, int pos) const;
     int32_t GetBits(uint32_t insn, int pos, int length) const;
 
-    bool IsADR(uint32_t insn) const;
-    bool IsADRP(uint32_t insn) const;
     bool IsLDR(uint32_t insn) const;
     bool IsLDRSTU(uint32_t insn) const;
     bool IsLDRSTUImm(uint32_t insn) const;
@@ -81,7 +161,12 @@ private:
 /* Memory Engine Class */
 class CGPMemoryEngine : public CGPErrorHandler {
 public:
+#if defined(__APPLE__)
     explicit CGPMemoryEngine(mach_port_t task);
+#elif defined(__linux__)
+    explicit CGPMemoryEngine(pid_t pid);
+#endif
+    explicit CGPMemoryEngine(std::unique_ptr<CGPMemoryBackend> backend);
     virtual ~CGPMemoryEngine();
 
 private:
@@ -89,38 +174,165 @@ private:
     void DeallocateResult();
     std::unique_ptr<Result> AllocateResult();
 
+    size_t ScanStride(size_t width) const;
+    bool CollectRegions(const AddrRange& range, std::vector<RegionInfo>& regions) const;
+    bool ReadThrough(uint64_t address, void* out, size_t len) const;
+    void DropFrozenWrites() const;
+
+    /* Hits of the mapped result file while one is loaded, result_ otherwise */
+    ResultView CurrentResults() const;
+    void ResetResults();
+    void DetachResultFile();
+
+    /* Named result set, "" is the current results */
+    bool FindResults(const std::string& name, ResultView& view) const;
+    void PutResults(const std::string& name, Result&& result);
+
+    /* find(data, size, address, hits) appends the offsets of matches starting in data */
+    template <typename Find>
+    void ScanWith(const AddrRange& range, size_t len, Find&& find);
+    template <typename Find>
+    bool NearByWith(int range, size_t len, Find&& find);
+
+    /* keep(address, value, span) runs once per hit in address order, false drops the hit */
+    template <typename Keep>
+    bool RefineWith(size_t len, Keep&& keep);
+
+    void RefineSnapshotPages(CGPValueType type, CGPSnapshotCompare mode, const uint8_t* delta);
+    void RefineSnapshotHits(CGPValueType type, CGPSnapshotCompare mode, const uint8_t* delta);
+
 public:
-    /* Memory Probe */
+    /* Memory Probe, scans add their hits to the results, which stay sorted and unique */
     void ScanMemory(const AddrRange& range, const void* target, size_t len);
+    void SetScanThreads(size_t threads); // 0 = all cores, 1 = calling thread only
+    void SetScanChunkSize(size_t bytes); // per thread buffer, rounded up to whole pages
+    void SetScanAlignment(size_t alignment); // power of two, 0 = natural alignment of the value, 1 = every byte
     void NearBySearch(int range, const void* target, size_t len);
+    void RefineResults(const void* target, size_t len, CGPCompare predicate = CGPCompare::Equal);
     bool SearchByAddress(uint64_t address, const void* target, size_t len);
 
+    /* Typed Probe, bound is the upper limit of Between or the epsilon of EqualEpsilon */
+    void ScanMemory(const AddrRange& range, CGPValueType type, CGPCompare predicate, const void* value, const void* bound = nullptr);
+    void NearBySearch(int range, CGPValueType type, CGPCompare predicate, const void* value, const void* bound = nullptr);
+    void RefineResults(CGPValueType type, CGPCompare predicate, const void* value, const void* bound = nullptr);
+
+    /* Group Search, replaces results with the members of every cluster holding all values within maxSpan bytes */
+    void GroupSearch(const AddrRange& range, const std::vector<GroupValue>& values, size_t maxSpan, bool ordered = false);
+
+    /* Region Map */
+    void SetRegionFilter(const RegionFilter& filter);
+    const RegionFilter& GetRegionFilter() const { return regionFilter_; }
+    bool UpdateRegionMap(const AddrRange& range);
+    const std::vector<RegionInfo>& GetRegionMap() const { return regionMap_; }
+
+    /* Unknown Value Scan */
+    bool CaptureSnapshot(const AddrRange& range); // clears results, every aligned value is a candidate until the first scan or refine
+    void RefineSnapshot(CGPValueType type, CGPSnapshotCompare mode, const void* delta = nullptr);
+    size_t GetSnapshotSize() const; // bytes held by the snapshot
+
+    /* Pointer Scan, aligned pointers of the writable regions in range indexed by pointee, then walked back from a target */
+    bool BuildPointerMap(const AddrRange& range, size_t maxPointers = 0); // 0 = no limit, past it nothing is kept
+    size_t GetPointerMapSize() const;
+    /* Writes one "module+0xBASE,0xOFF,..." line per path to target, returns the number of paths */
+    uint64_t ScanPointerPaths(uint64_t target, const PointerScanOptions& options, const std::string& path);
+
     std::unique_ptr< std::vector<uint8_t> > ReadMemory(uint64_t address, size_t len) const;
     bool WriteMemory(uint64_t address, const void* data, size_t len);
 
+    /* Scatter read into caller buffers, returns the requests that completed, a failed one does not invalidate the engine */
+    size_t ReadBatch(ReadRequest* requests, size_t count);
+
+    /* Page Cache, consulted by ReadMemory and SearchByAddress, pages written through the engine or the freezer drop out */
+    void SetPageCache(size_t bytes); // 0 turns it off
+    void InvalidatePageCache(); // new epoch, e.g. once per frame
+
+    /* Value Freezer, a background thread rewrites each value every intervalMs, values on one page share a read */
+    uint64_t FreezeValue(uint64_t address, const void* data, size_t len, uint32_t intervalMs = 16); // entry id, 0 on failure
+    void UnfreezeValue(uint64_t id);
+    void UnfreezeAll();
+    FreezeStats GetFreezerStats() const;
+
+    /* Watch List, changed width-byte values come back as (address, old, new), quiet ranges are polled less often */
+    uint32_t AddWatch(uint64_t address, size_t size, size_t width = 4, uint32_t minIntervalMs = 16, uint32_t maxIntervalMs = 1000);
+    void RemoveWatch(uint32_t id);
+    void SetWatchCallback(WatchCallback callback); // runs on the watch thread, an empty one goes back to the ring
+    size_t PollWatchChanges(WatchChange* out, size_t max);
+
+    /* Result Files, loading maps the file and the next refine reads the hits from it in place */
+    bool SaveResults(const std::string& path) const;
+    bool LoadResults(const std::string& path, bool anyTarget = false); // false for another process unless anyTarget
+
     std::vector<void*> GetAllResults() const;
     std::vector<void*> GetResults(int count) const;
 
+    /* Paged Results, sorted and unique, a page costs O(count) however many hits there are */
+    size_t GetResultCount() const;
+    std::vector<void*> GetResults(size_t offset, size_t count) const;
+    CGPResultRange GetResultRange() const; // non-owning, valid until the results change
+
+    /* Named Result Sets, "" names the current results, set operations merge the packed hits across the pool */
+    bool StoreResults(const std::string& name); // copies the current results under name
+    bool RestoreResults(const std::string& name); // the current results become a copy of name
+    void DropResults(const std::string& name);
+    std::vector<std::string> GetResultSetNames() const;
+    size_t GetResultCount(const std::string& name) const;
+    bool CombineResults(const std::string& target, const std::string& a, CGPResultSetOp op, const std::string& b); // target = a op b
+    bool ShiftResults(const std::string& target, const std::string& source, int64_t delta); // target = source + delta
+
     void* AllocateMemory(size_t size);
     bool DeallocateMemory(void* address, size_t size);
 
     /* Memory Guard */
+#if defined(__APPLE__)
     kern_return_t ProtectMemory(void* address, size_t size, vm_prot_t protection);
     kern_return_t QueryMemory(void* address, vm_size_t* size, vm_prot_t* protection, vm_inherit_t* inheritance) const;
+#endif
+    bool QueryRegion(uint64_t address, RegionInfo* region) const;
 
     bool isValid_;
     std::string error_;
 
 protected:
-    mach_port_t task_;
+    CGPThreadPool* ThreadPool();
+
+    std::unique_ptr<CGPMemoryBackend> backend_;
     std::unique_ptr<Result> result_;
+    std::unique_ptr<CGPResultFile> resultFile_; // loaded results, stand in for result_ until replaced
+    std::map<std::string, Result> resultSets_;
     size_t pageSize_;
+
+    size_t scanThreads_;
+    size_t scanChunkSize_;
+    size_t scanAlignment_;
+
+    RegionFilter regionFilter_;
+    std::vector<RegionInfo> regionMap_;
+    std::unique_ptr<CGPThreadPool> threadPool_;
+
+    std::unique_ptr<CGPSnapshot> snapshot_;
+    bool snapshotAll_; // no refine or scan since CaptureSnapshot, results are not yet populated
+
+    std::unique_ptr<CGPPageCache> pageCache_;
+    std::unique_ptr<CGPFreezer> freezer_; // declared after backend_, both threads stop before it goes away
+    std::unique_ptr<CGPWatcher> watcher_;
+
+    std::unique_ptr<CGPPointerMap> pointerMap_;
+    std::vector<PointerModule> pointerModules_;
+
+    /* ReadBatch scratch, kept so a steady polling loop does not allocate */
+    std::vector<size_t> readOrder_;
+    std::vector<size_t> readGroupEnds_; // per op, end of its requests in readOrder_
+    std::vector<RemoteIO> readOps_;
+    std::vector<size_t> readRetries_;   // requests whose shared read fell short
+    std::vector<uint8_t> readStaging_;
 };
 
 /* Memory Scanner Class */
 class CGPMemoryScanner final : public CGPMemoryEngine, public CGPInstructionDecoder {
 public:
     CGPMemoryScanner(const std::string& binaryName, const std::string& segmentName = "__TEXT");
+    /* Offline over a Mach-O on disk, results are the file's unslid vmaddrs */
+    explicit CGPMemoryScanner(std::shared_ptr<const CGPMachOFile> image, const std::string& segmentName = "__TEXT");
     ~CGPMemoryScanner() override = default;
 
 public:
@@ -131,11 +343,26 @@ public:
     uintptr_t Find_LDRSTR_Sig64(const std::string& signature, int step = 0) const;
     uintptr_t Find_LDRSTR_Sig32(const std::string& signature, int step = 0) const;
 
+    /* Batch of shortcuts, every signature is matched in one pass over the segment */
+    void ResolveSignatures(std::vector<SigEntry>& entries);
+
+    /* Signature Cache, match offsets from the image base persisted per binary identity */
+    bool SetSignatureCache(const std::string& path); // false when nothing usable was on disk, the cache still fills
+    bool SaveSignatureCache() const; // only writes when something new was resolved
+
+    /* Cross References, every ADR and ADRP pair in the segment decoded once */
+    bool BuildXrefIndex();
+    std::vector<uint64_t> FindXrefs(uint64_t target) const; // instructions referencing target
+    std::vector<XrefEntry> FindXrefs(uint64_t start, uint64_t end) const; // references into [start, end), by target
+    size_t GetXrefCount() const { return xrefs_.size(); }
+
 private:
     /* Scanner Utils */
-    bool ComparePattern(const char* data, const char* pattern, const char* mask) const;
-    uintptr_t SearchInRange(uintptr_t start, const char* pattern, const std::string& mask) const;
     uintptr_t GetPageOffset(uintptr_t address) const;
+    uintptr_t ResolveSig(uintptr_t insnAddress, CGPSigKind kind) const;
+    uintptr_t FindSigMatch(const std::string& signature) const;
+    uintptr_t CachedSigMatch(const std::string& signature, const CGPPattern& pattern) const;
+    void DecodeXrefs(size_t first, size_t last, std::vector<XrefEntry>& out) const;
 
 public:
     /* Byte Pattern */
@@ -146,10 +373,22 @@ public:
     std::vector<uintptr_t> FindIDAPatternAll(const std::string& pattern) const;
     uintptr_t FindIDAPatternFirst(const std::string& pattern) const;
 
+    /* Compiled Pattern, build it once and reuse it across lookups */
+    std::vector<uintptr_t> FindPatternAll(const CGPPattern& pattern) const;
+    uintptr_t FindPatternFirst(const CGPPattern& pattern) const;
+
 public:
     /* Segment Data */
+    uintptr_t ImageBase_;
     uintptr_t SegmentStart_;
     uintptr_t SegmentEnd_;
+
+private:
+    const uint8_t* segmentData_; // SegmentStart_ itself, or its bytes in the file mapping
+    uint8_t imageKey_[CGP_SigCache_Key_Size]; // LC_UUID, or segment hash and size
+    std::unique_ptr<CGPSigCache> sigCache_;
+
+    std::vector<XrefEntry> xrefs_; // by target, then by from
 };
 
 #endif /* CGPMemory_h */
@@ -0,0 +1,188 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPPageCache.cpp  * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPPageCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#pragma mark - CGPPageCache Implementation -
+
+CGPPageCache::CGPPageCache(size_t pageSize, size_t capacity)
+    : pageSize_(pageSize), slots_(std::max<size_t>(capacity / pageSize, 1)), used_(0), epoch_(1),
+      slab_(new uint8_t[slots_ * pageSize_]), entries_(slots_), head_(None), tail_(None), hits_(0), misses_(0)
+{
+    index_.reserve(slots_);
+}
+
+void CGPPageCache::Unlink(uint32_t slot)
+{
+    CacheSlot& entry = entries_[slot];
+
+    if (entry.prev != None)
+    {
+        entries_[entry.prev].next = entry.next;
+    }
+    else
+    {
+        head_ = entry.next;
+    }
+
+    if (entry.next != None)
+    {
+        entries_[entry.next].prev = entry.prev;
+    }
+    else
+    {
+        tail_ = entry.prev;
+    }
+}
+
+void CGPPageCache::PushFront(uint32_t slot)
+{
+    CacheSlot& entry = entries_[slot];
+
+    entry.prev = None;
+    entry.next = head_;
+
+    if (head_ != None)
+    {
+        entries_[head_].prev = slot;
+    }
+
+    head_ = slot;
+
+    if (tail_ == None)
+    {
+        tail_ = slot;
+    }
+}
+
+/* Slot for page, a fresh one while the slab has room, the least recently used after that */
+uint32_t CGPPageCache::Acquire(uint64_t page)
+{
+    uint32_t slot;
+
+    if (used_ < slots_)
+    {
+        slot = static_cast<uint32_t>(used_++);
+    }
+    else
+    {
+        slot = tail_;
+        Unlink(slot);
+
+        auto it = index_.find(entries_[slot].page);
+
+        if (it != index_.end() && it->second == slot)
+        {
+            index_.erase(it);
+        }
+    }
+
+    entries_[slot].page = page;
+    entries_[slot].epoch = 0;
+    index_[page] = slot;
+    PushFront(slot);
+
+    return slot;
+}
+
+bool CGPPageCache::Read(const CGPMemoryBackend& backend, uint64_t address, void* out, size_t len)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint8_t* dst = static_cast<uint8_t*>(out);
+    uint64_t end = address + len;
+
+    for (uint64_t page = address & ~static_cast<uint64_t>(pageSize_ - 1); page < end; page += pageSize_)
+    {
+        uint32_t slot;
+        auto it = index_.find(page);
+
+        if (it != index_.end())
+        {
+            slot = it->second;
+            Unlink(slot);
+            PushFront(slot);
+        }
+        else
+        {
+            slot = Acquire(page);
+        }
+
+        uint8_t* data = slab_.get() + static_cast<size_t>(slot) * pageSize_;
+
+        if (entries_[slot].epoch == epoch_)
+        {
+            ++hits_;
+        }
+        else
+        {
+            ++misses_;
+
+            if (!backend.Read(page, data, pageSize_))
+            { // unmapped page, nothing is cached for it
+                entries_[slot].epoch = 0;
+                return false;
+            }
+
+            entries_[slot].epoch = epoch_;
+        }
+
+        uint64_t from = std::max(page, address);
+        uint64_t to = std::min(page + pageSize_, end);
+
+        memcpy(dst + (from - address), data + (from - page), static_cast<size_t>(to - from));
+    }
+
+    return true;
+}
+
+void CGPPageCache::Invalidate(uint64_t address, size_t len)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (len == 0)
+    {
+        return;
+    }
+
+    uint64_t first = address & ~static_cast<uint64_t>(pageSize_ - 1);
+    uint64_t last = (address + len - 1) & ~static_cast<uint64_t>(pageSize_ - 1);
+
+    // a huge range is cheaper to test against the cached pages
+    if ((last - first) / pageSize_ >= used_)
+    {
+        for (size_t slot = 0; slot < used_; ++slot)
+        {
+            if (entries_[slot].page >= first && entries_[slot].page <= last)
+            {
+                entries_[slot].epoch = 0;
+            }
+        }
+
+        return;
+    }
+
+    for (uint64_t page = first; page <= last; page += pageSize_)
+    {
+        auto it = index_.find(page);
+
+        if (it != index_.end())
+        {
+            entries_[it->second].epoch = 0;
+        }
+    }
+}
+
+void CGPPageCache::NextEpoch()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++epoch_;
+}
@@ -0,0 +1,75 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPPageCache.h  * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPPageCache_h
+#define CGPPageCache_h
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "CGPBackend.h"
+
+/*
+ * Remote Page Cache
+ * Whole target pages in a fixed slab, least recently used evicted first.
+ * A page is only trusted within the epoch it was read in, NextEpoch()
+ * drops everything in O(1) and Invalidate() drops single pages.
+ */
+class CGPPageCache {
+public:
+    /* capacity is rounded down to whole pages, at least one */
+    CGPPageCache(size_t pageSize, size_t capacity);
+
+    size_t PageSize() const { return pageSize_; }
+    size_t Capacity() const { return slots_ * pageSize_; }
+
+    /* Copies [address, address + len) to out, missing pages are read whole from backend */
+    bool Read(const CGPMemoryBackend& backend, uint64_t address, void* out, size_t len);
+
+    void Invalidate(uint64_t address, size_t len);
+    void NextEpoch();
+
+    size_t Hits() const { return hits_; }
+    size_t Misses() const { return misses_; }
+
+private:
+    typedef struct _cache_slot {
+        uint64_t page;
+        uint64_t epoch;     // 0 = holds nothing
+        uint32_t prev;
+        uint32_t next;
+    } CacheSlot;
+
+    static constexpr uint32_t None = UINT32_MAX;
+
+    uint32_t Acquire(uint64_t page);
+    void Unlink(uint32_t slot);
+    void PushFront(uint32_t slot);
+
+    size_t pageSize_;
+    size_t slots_;
+    size_t used_;
+    uint64_t epoch_;
+
+    std::unique_ptr<uint8_t[]> slab_;
+    std::vector<CacheSlot> entries_;
+    std::unordered_map<uint64_t, uint32_t> index_;
+    uint32_t head_;     // most recently used
+    uint32_t tail_;
+
+    size_t hits_;
+    size_t misses_;
+
+    std::mutex mutex_;
+};
+
+#endif /* CGPPageCache_h */
@@ -0,0 +1,390 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPPattern.cpp * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPPattern.h"
+
+#include <algorithm>
+#include <cstring>
+
+static inline int HexNibble(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+/* Rough frequency of a byte in ARM64 code, padding and the common opcode/register bytes score high */
+static inline int ByteCost(uint8_t byte)
+{
+    switch (byte)
+    {
+        case 0x00:
+        case 0xFF:
+            return 3;
+        case 0x03: case 0x1F: case 0x20: case 0x34: case 0x35: case 0x52: case 0x54:
+        case 0x5F: case 0x7B: case 0x91: case 0x94: case 0x97: case 0xA9: case 0xAA:
+        case 0xB4: case 0xB5: case 0xB9: case 0xD1: case 0xD6: case 0xE0: case 0xE1:
+        case 0xEB: case 0xF1: case 0xF9: case 0xFD:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+#pragma mark - CGPPattern Implementation -
+
+CGPPattern::CGPPattern()
+    : runStart_(0), runLength_(0), anchor_(0)
+{
+}
+
+CGPPattern::CGPPattern(const std::string& ida)
+    : CGPPattern()
+{
+    size_t length = ida.length();
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (ida[i] == ' ')
+        {
+            continue;
+        }
+
+        if (ida[i] == '?')
+        {
+            bytes_.push_back(0);
+            solid_.push_back(0);
+            continue;
+        }
+
+        int high = HexNibble(ida[i]);
+        int low = (i + 1) < length ? HexNibble(ida[i + 1]) : -1;
+
+        if (high < 0 || low < 0)
+        { // invalid pattern character
+            bytes_.clear();
+            solid_.clear();
+            return;
+        }
+
+        bytes_.push_back(static_cast<uint8_t>((high << 4) | low));
+        solid_.push_back(1);
+        ++i; // skip next character
+    }
+
+    Compile();
+}
+
+CGPPattern::CGPPattern(const std::vector<char>& bytes, const std::string& mask)
+    : CGPPattern()
+{
+    if (bytes.size() != mask.size())
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        bytes_.push_back(static_cast<uint8_t>(bytes[i]));
+        solid_.push_back(mask[i] == 'x');
+    }
+
+    Compile();
+}
+
+void CGPPattern::Compile()
+{
+    size_t length = bytes_.size();
+
+    // longest solid run
+    for (size_t i = 0; i < length;)
+    {
+        if (!solid_[i])
+        {
+            ++i;
+            continue;
+        }
+
+        size_t start = i;
+
+        while (i < length && solid_[i])
+        {
+            ++i;
+        }
+
+        if (i - start > runLength_)
+        {
+            runStart_ = start;
+            runLength_ = i - start;
+        }
+    }
+
+    int best = 0;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (solid_[i] && (best == 0 || ByteCost(bytes_[i]) < best))
+        {
+            best = ByteCost(bytes_[i]);
+            anchor_ = i;
+        }
+    }
+
+    for (size_t& skip : skip_)
+    {
+        skip = runLength_;
+    }
+
+    // the last byte of the run keeps the full shift
+    for (size_t k = 0; k + 1 < runLength_; ++k)
+    {
+        skip_[bytes_[runStart_ + k]] = runLength_ - 1 - k;
+    }
+}
+
+bool CGPPattern::Matches(const uint8_t* at) const
+{
+    for (size_t i = 0; i < bytes_.size(); ++i)
+    {
+        if (solid_[i] && at[i] != bytes_[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t CGPPattern::FindFrom(const uint8_t* data, size_t size, size_t from) const
+{
+    size_t last = size - bytes_.size(); // last window start
+    uint8_t target = bytes_[anchor_];
+
+    for (size_t at = from; at <= last;)
+    {
+        const uint8_t* hit = static_cast<const uint8_t*>(memchr(data + at + anchor_, target, last - at + 1));
+
+        if (!hit)
+        {
+            break;
+        }
+
+        at = hit - data - anchor_;
+
+        if (Matches(data + at))
+        {
+            return at;
+        }
+
+        // the run cannot match again before the shift its last byte allows
+        if (runLength_ >= CGP_Pattern_Skip_Run)
+        {
+            at += skip_[data[at + runStart_ + runLength_ - 1]];
+        }
+        else
+        {
+            ++at;
+        }
+    }
+
+    return npos;
+}
+
+size_t CGPPattern::FindFirst(const uint8_t* data, size_t size, size_t from) const
+{
+    if (!IsValid() || size < bytes_.size() || from > size - bytes_.size())
+    {
+        return npos;
+    }
+
+    if (runLength_ == 0)
+    {
+        return from; // only wildcards
+    }
+
+    return FindFrom(data, size, from);
+}
+
+void CGPPattern::FindAll(const uint8_t* data, size_t size, std::vector<size_t>& hits) const
+{
+    for (size_t at = FindFirst(data, size); at != npos; at = FindFirst(data, size, at + bytes_.size()))
+    {
+        hits.push_back(at);
+    }
+}
+
+#pragma mark - CGPPatternSet Implementation -
+
+CGPPatternSet::CGPPatternSet(const std::vector<CGPPattern>& patterns)
+    : patterns_(patterns), maxSize_(0)
+{
+    const uint32_t none = UINT32_MAX;
+
+    next_.assign(256, none);
+    ends_.resize(1);
+
+    // trie over the runs
+    for (size_t i = 0; i < patterns_.size(); ++i)
+    {
+        const CGPPattern& pattern = patterns_[i];
+
+        if (!pattern.IsValid())
+        {
+            continue;
+        }
+
+        maxSize_ = std::max(maxSize_, pattern.Size());
+
+        if (pattern.RunLength() == 0)
+        {
+            wildcards_.push_back(static_cast<uint32_t>(i));
+            continue;
+        }
+
+        uint32_t state = 0;
+
+        for (size_t k = 0; k < pattern.RunLength(); ++k)
+        {
+            size_t edge = state * 256 + pattern.Run()[k];
+
+            if (next_[edge] == none)
+            {
+                next_[edge] = static_cast<uint32_t>(ends_.size());
+                ends_.emplace_back();
+                next_.resize(next_.size() + 256, none);
+            }
+
+            state = next_[edge];
+        }
+
+        ends_[state].push_back(static_cast<uint32_t>(i));
+    }
+
+    size_t states = ends_.size();
+    std::vector<uint32_t> fail(states, 0);
+    std::vector<uint32_t> queue;
+
+    output_.assign(states, 0);
+    queue.reserve(states);
+
+    for (size_t c = 0; c < 256; ++c)
+    {
+        if (next_[c] == none)
+        {
+            next_[c] = 0;
+        }
+        else
+        {
+            queue.push_back(next_[c]);
+        }
+    }
+
+    // breadth first, so every fail target already has its full transition row
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        uint32_t state = queue[head];
+
+        for (size_t c = 0; c < 256; ++c)
+        {
+            uint32_t& edge = next_[state * 256 + c];
+            uint32_t fallback = next_[fail[state] * 256 + c];
+
+            if (edge == none)
+            {
+                edge = fallback;
+                continue;
+            }
+
+            fail[edge] = fallback;
+            output_[edge] = ends_[fallback].empty() ? output_[fallback] : fallback;
+            queue.push_back(edge);
+        }
+    }
+}
+
+void CGPPatternSet::FindFirst(const uint8_t* data, size_t size, size_t from, size_t to, std::vector<size_t>& first) const
+{
+    to = std::min(to, size);
+
+    if (from >= to || maxSize_ == 0)
+    {
+        return;
+    }
+
+    size_t remaining = 0;
+
+    for (size_t i = 0; i < patterns_.size(); ++i)
+    {
+        if (patterns_[i].RunLength() != 0 && first[i] >= to)
+        {
+            ++remaining;
+        }
+    }
+
+    for (uint32_t index : wildcards_)
+    {
+        if (from + patterns_[index].Size() <= size)
+        {
+            first[index] = std::min(first[index], from);
+        }
+    }
+
+    // the last window starting before to may end maxSize_ - 1 bytes past it
+    size_t stop = std::min(size, to + maxSize_ - 1);
+    uint32_t state = 0;
+
+    for (size_t pos = from; pos < stop && remaining != 0; ++pos)
+    {
+        state = next_[state * 256 + data[pos]];
+
+        for (uint32_t match = ends_[state].empty() ? output_[state] : state; match != 0; match = output_[match])
+        {
+            for (uint32_t index : ends_[match])
+            {
+                const CGPPattern& pattern = patterns_[index];
+                size_t lead = pattern.RunStart() + pattern.RunLength();
+
+                if (pos + 1 < from + lead)
+                {
+                    continue; // window would start before from
+                }
+
+                size_t start = pos + 1 - lead;
+
+                // hits of one pattern arrive in address order, the first one wins
+                if (start >= to || start >= first[index] || start + pattern.Size() > size)
+                {
+                    continue;
+                }
+
+                if (pattern.Matches(data + start))
+                {
+                    if (first[index] >= to)
+                    {
+                        --remaining;
+                    }
+
+                    first[index] = start;
+                }
+            }
+        }
+    }
+}
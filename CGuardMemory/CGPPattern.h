@@ -0,0 +1,95 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPPattern.h * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPPattern_h
+#define CGPPattern_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Shortest run worth a skip table, shorter ones step one byte past a failed candidate */
+#define CGP_Pattern_Skip_Run 4
+
+/*
+ * Compiled Byte Pattern
+ * Parsed once and reused across searches. Candidates come from memchr on
+ * the least common solid byte and are verified against the whole pattern.
+ * After a miss the longest run without wildcards gives a Horspool shift,
+ * so frequent anchors do not cost a memchr call per byte.
+ */
+class CGPPattern {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    CGPPattern();
+    /* "E0 03 ? AA", every '?' is one wildcard byte, a malformed string gives an invalid pattern */
+    explicit CGPPattern(const std::string& ida);
+    /* mask 'x' compares the byte, anything else is a wildcard */
+    CGPPattern(const std::vector<char>& bytes, const std::string& mask);
+
+    bool IsValid() const { return !bytes_.empty(); }
+    size_t Size() const { return bytes_.size(); }
+
+    /* Longest run without wildcards, empty when the pattern is all wildcards */
+    const uint8_t* Run() const { return bytes_.data() + runStart_; }
+    size_t RunStart() const { return runStart_; }
+    size_t RunLength() const { return runLength_; }
+
+    /* at holds Size() bytes */
+    bool Matches(const uint8_t* at) const;
+
+    /* Offset of the first match at or after from, npos if there is none */
+    size_t FindFirst(const uint8_t* data, size_t size, size_t from = 0) const;
+    /* Non-overlapping matches, each search resumes past the previous hit */
+    void FindAll(const uint8_t* data, size_t size, std::vector<size_t>& hits) const;
+
+private:
+    void Compile();
+
+    size_t FindFrom(const uint8_t* data, size_t size, size_t from) const;
+
+    std::vector<uint8_t> bytes_;
+    std::vector<uint8_t> solid_;   // 1 where the byte is compared
+
+    size_t runStart_;
+    size_t runLength_;
+    size_t anchor_;                // least common solid byte, memchr target
+    size_t skip_[256];
+};
+
+/*
+ * Multi Pattern Matcher
+ * An Aho-Corasick automaton over the longest run of every pattern finds
+ * all of them in one pass, a run hit is verified against its full pattern.
+ * Transitions are a dense 256-wide table, sized for a few hundred
+ * signatures rather than for large dictionaries.
+ */
+class CGPPatternSet {
+public:
+    explicit CGPPatternSet(const std::vector<CGPPattern>& patterns);
+
+    size_t Count() const { return patterns_.size(); }
+    /* Longest pattern, the overlap a split scan needs past its end */
+    size_t MaxSize() const { return maxSize_; }
+
+    /* first[i] is lowered to the first match of pattern i starting in [from, to), first holds Count() entries */
+    void FindFirst(const uint8_t* data, size_t size, size_t from, size_t to, std::vector<size_t>& first) const;
+
+private:
+    std::vector<CGPPattern> patterns_;
+    size_t maxSize_;
+
+    std::vector<uint32_t> next_;                    // state * 256 + byte
+    std::vector<uint32_t> output_;                  // nearest state on the suffix chain ending a run, 0 = none
+    std::vector< std::vector<uint32_t> > ends_;     // patterns whose run ends in the state
+    std::vector<uint32_t> wildcards_;               // patterns without a run match everywhere
+};
+
+#endif /* CGPPattern_h */
@@ -0,0 +1,95 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPPointerMap.cpp * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPPointerMap.h"
+
+#include <algorithm>
+
+static inline bool RefLess(const PointerRef& a, const PointerRef& b)
+{
+    return a.value < b.value || (a.value == b.value && a.holder < b.holder);
+}
+
+#pragma mark - CGPPointerMap Implementation -
+
+void CGPPointerMap::Build(std::vector< std::vector<PointerRef> >& parts, CGPThreadPool& pool)
+{
+    refs_.clear();
+
+    size_t total = 0;
+
+    for (const auto& part : parts)
+    {
+        total += part.size();
+    }
+
+    refs_.reserve(total);
+
+    // run boundaries in refs_, each part is released once copied so the peak stays one part above the index
+    std::vector<size_t> bounds = { 0 };
+
+    for (auto& part : parts)
+    {
+        if (part.empty())
+        {
+            continue;
+        }
+
+        refs_.insert(refs_.end(), part.begin(), part.end());
+        bounds.push_back(refs_.size());
+        std::vector<PointerRef>().swap(part);
+    }
+
+    parts.clear();
+
+    pool.Run(bounds.size() - 1, [&](size_t run, size_t)
+    {
+        std::sort(refs_.begin() + bounds[run], refs_.begin() + bounds[run + 1], RefLess);
+    });
+
+    while (bounds.size() > 2)
+    {
+        size_t pairs = (bounds.size() - 1) / 2;
+
+        pool.Run(pairs, [&](size_t pair, size_t)
+        {
+            std::inplace_merge(refs_.begin() + bounds[2 * pair], refs_.begin() + bounds[2 * pair + 1],
+                               refs_.begin() + bounds[2 * pair + 2], RefLess);
+        });
+
+        std::vector<size_t> merged;
+
+        for (size_t i = 0; i < bounds.size(); i += 2)
+        {
+            merged.push_back(bounds[i]);
+        }
+
+        if (merged.back() != bounds.back())
+        { // odd run out, carried to the next round
+            merged.push_back(bounds.back());
+        }
+
+        bounds.swap(merged);
+    }
+}
+
+void CGPPointerMap::Clear()
+{
+    std::vector<PointerRef>().swap(refs_);
+}
+
+size_t CGPPointerMap::Find(uint64_t low, uint64_t high, const PointerRef** first) const
+{
+    auto begin = std::lower_bound(refs_.begin(), refs_.end(), low,
+                                  [](const PointerRef& ref, uint64_t value) { return ref.value < value; });
+    auto end = std::upper_bound(begin, refs_.end(), high,
+                                [](uint64_t value, const PointerRef& ref) { return value < ref.value; });
+
+    *first = refs_.data() + (begin - refs_.begin());
+    return static_cast<size_t>(end - begin);
+}
@@ -0,0 +1,44 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPPointerMap.h * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPPointerMap_h
+#define CGPPointerMap_h
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CGPThreadPool.h"
+
+typedef struct _pointer_ref {
+    uint64_t value;     // pointee
+    uint64_t holder;    // 8-byte aligned address the value was read from
+} PointerRef;
+
+/*
+ * Reverse Pointer Index
+ * Every (value, holder) pair of a capture sorted by value, so the holders
+ * of anything in [low, high] are one binary search and a contiguous run.
+ */
+class CGPPointerMap {
+public:
+    /* Consumes parts, each is sorted on its own lane and the runs are merged pairwise */
+    void Build(std::vector< std::vector<PointerRef> >& parts, CGPThreadPool& pool);
+    void Clear();
+
+    size_t Size() const { return refs_.size(); }
+    size_t Bytes() const { return refs_.capacity() * sizeof(PointerRef); }
+
+    /* Refs whose value lies in [low, high], first is set to the lowest one */
+    size_t Find(uint64_t low, uint64_t high, const PointerRef** first) const;
+
+private:
+    std::vector<PointerRef> refs_;
+};
+
+#endif /* CGPPointerMap_h */
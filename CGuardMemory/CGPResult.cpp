@@ -0,0 +1,450 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPResult.cpp * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPResult.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+
+static inline size_t VarintSize(uint64_t value)
+{
+    size_t size = 1;
+
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        ++size;
+    }
+
+    return size;
+}
+
+static inline size_t WriteVarint(uint8_t* out, uint64_t value)
+{
+    size_t i = 0;
+
+    while (value >= 0x80)
+    {
+        out[i++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+
+    out[i++] = static_cast<uint8_t>(value);
+    return i;
+}
+
+/* Picks the smaller encoding for n ascending values, fills all but region_base and data_offset */
+template <typename T>
+static void PlanRegion(const T* values, size_t n, ResultRegion& region)
+{
+    // widest power-of-two stride dividing every gap, and the packed size
+    uint64_t gaps = 0;
+    size_t packedSize = 0;
+
+    for (size_t i = 1; i < n; ++i)
+    {
+        uint64_t delta = values[i] - values[i - 1];
+        gaps |= delta;
+        packedSize += VarintSize(delta);
+    }
+
+    uint8_t stride = 8;
+
+    while (stride > 1 && (gaps & (stride - 1)))
+    {
+        stride >>= 1;
+    }
+
+    uint64_t slots = (values[n - 1] - values[0]) / stride;
+    size_t bitmapSize = static_cast<size_t>(slots / 8 + 1);
+
+    region.count = static_cast<uint32_t>(n);
+    region.stride = stride;
+    region.encoding = (bitmapSize < packedSize) ? CGP_Result_Bitmap : CGP_Result_Packed;
+    region.data_size = static_cast<uint32_t>((bitmapSize < packedSize) ? bitmapSize : packedSize);
+}
+
+template <typename T>
+static void EncodeRegion(const T* values, size_t n, const ResultRegion& region, uint8_t* out)
+{
+    if (region.encoding == CGP_Result_Bitmap)
+    {
+        memset(out, 0, region.data_size);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint64_t slot = (values[i] - values[0]) / region.stride;
+            out[slot >> 3] |= static_cast<uint8_t>(1u << (slot & 7));
+        }
+
+        return;
+    }
+
+    for (size_t i = 1; i < n; ++i)
+    {
+        out += WriteVarint(out, values[i] - values[i - 1]);
+    }
+}
+
+#ifndef NDEBUG
+/* Highest stored hit, debug builds check that every append keeps the result sorted and unique */
+static uint64_t LastAddress(const Result& result)
+{
+    return CGPResultRange(result.View())[result.count - 1];
+}
+
+template <typename T>
+static bool StrictlyAscending(const T* values, size_t n)
+{
+    return std::adjacent_find(values, values + n, std::greater_equal<T>()) == values + n;
+}
+#endif
+
+#pragma mark - Result Implementation -
+
+void _result::Clear()
+{
+    regions.clear();
+    pool.clear();
+    count = 0;
+}
+
+void _result::Append(uint64_t base, const size_t* offsets, size_t n)
+{
+    assert(StrictlyAscending(offsets, n));
+    assert(n == 0 || count == 0 || base + offsets[0] > LastAddress(*this));
+
+    while (n > 0)
+    {
+        size_t take = std::min(n, static_cast<size_t>(CGP_Result_Region_Hits));
+
+        ResultRegion region = {};
+        PlanRegion(offsets, take, region);
+        region.region_base = base + offsets[0];
+        region.first = count;
+        region.data_offset = pool.size();
+
+        pool.resize(pool.size() + region.data_size);
+        EncodeRegion(offsets, take, region, pool.data() + region.data_offset);
+
+        regions.push_back(region);
+        count += take;
+
+        offsets += take;
+        n -= take;
+    }
+}
+
+void _result::AppendAddresses(const uint64_t* addresses, size_t n)
+{
+    std::vector<size_t> offsets;
+    size_t first = 0;
+
+    while (first < n)
+    {
+        uint64_t base = addresses[first];
+        size_t last = first + 1;
+
+        offsets.clear();
+        offsets.push_back(0);
+
+        while (last < n && addresses[last] - addresses[last - 1] <= CGP_Result_Region_Gap)
+        {
+            offsets.push_back(static_cast<size_t>(addresses[last] - base));
+            ++last;
+        }
+
+        Append(base, offsets.data(), offsets.size());
+        first = last;
+    }
+}
+
+void _result::AppendRegion(const uint64_t* addresses, size_t n)
+{
+    assert(StrictlyAscending(addresses, n));
+    assert(n == 0 || count == 0 || addresses[0] > LastAddress(*this));
+
+    while (n > 0)
+    {
+        size_t take = std::min(n, static_cast<size_t>(CGP_Result_Region_Hits));
+
+        ResultRegion region = {};
+        PlanRegion(addresses, take, region);
+        region.region_base = addresses[0];
+        region.first = count;
+        region.data_offset = pool.size();
+
+        pool.resize(pool.size() + region.data_size);
+        EncodeRegion(addresses, take, region, pool.data() + region.data_offset);
+
+        regions.push_back(region);
+        count += take;
+
+        addresses += take;
+        n -= take;
+    }
+}
+
+void _result::AppendResult(const _result& other)
+{
+    AppendResult(other.View());
+}
+
+void _result::AppendResult(const ResultView& other)
+{
+    assert(other.count == 0 || count == 0 || other.regions[0].region_base > LastAddress(*this));
+
+    uint64_t shift = pool.size();
+    uint64_t poolSize = 0;
+
+    for (size_t i = 0; i < other.region_count; ++i)
+    {
+        poolSize = std::max<uint64_t>(poolSize, other.regions[i].data_offset + other.regions[i].data_size);
+    }
+
+    pool.insert(pool.end(), other.pool, other.pool + poolSize);
+
+    for (size_t i = 0; i < other.region_count; ++i)
+    {
+        ResultRegion region = other.regions[i];
+        region.first += count;
+        region.data_offset += shift;
+        regions.push_back(region);
+    }
+
+    count += other.count;
+}
+
+#pragma mark - CGPResultCompactor Implementation -
+
+CGPResultCompactor::CGPResultCompactor(Result& result)
+    : result_(result), regions_(0), pool_(0), count_(0)
+{
+}
+
+void CGPResultCompactor::Keep(const uint64_t* addresses, size_t n)
+{
+    if (n == 0)
+    {
+        return;
+    }
+
+    // a subset never encodes larger than its region, so the write stays behind the read
+    ResultRegion region = {};
+    PlanRegion(addresses, n, region);
+    region.region_base = addresses[0];
+    region.first = count_;
+    region.data_offset = pool_;
+
+    EncodeRegion(addresses, n, region, result_.pool.data() + pool_);
+
+    result_.regions[regions_++] = region;
+    pool_ += region.data_size;
+    count_ += n;
+}
+
+void CGPResultCompactor::Finish()
+{
+    result_.regions.resize(regions_);
+    result_.pool.resize(pool_);
+    result_.count = count_;
+}
+
+#pragma mark - CGPResultRange Implementation -
+
+size_t _result_view::FindRegion(size_t index) const
+{
+    const ResultRegion* it = std::upper_bound(regions, regions + region_count, static_cast<uint64_t>(index),
+                                              [](uint64_t value, const ResultRegion& region) { return value < region.first; });
+
+    return static_cast<size_t>(it - regions) - 1;
+}
+
+size_t _result_view::LowerBound(uint64_t address) const
+{
+    const ResultRegion* it = std::upper_bound(regions, regions + region_count, address,
+                                              [](uint64_t value, const ResultRegion& region) { return value < region.region_base; });
+
+    if (it == regions)
+    {
+        return 0;
+    }
+
+    const ResultRegion& region = *(it - 1);
+    size_t below = 0;
+
+    ForEachInRegion(region, [&](uint64_t hit)
+    {
+        if (hit >= address)
+        {
+            return false;
+        }
+
+        ++below;
+        return true;
+    });
+
+    return static_cast<size_t>(region.first) + below;
+}
+
+CGPResultRange::Iterator::Iterator(const ResultView& view, size_t index)
+    : view_(view), index_(index), region_(0), cursor_(0), address_(0)
+{
+    if (index < view_.count)
+    {
+        Seek(index);
+    }
+}
+
+void CGPResultRange::Iterator::Seek(size_t index)
+{
+    index_ = index;
+
+    if (index_ >= view_.count)
+    {
+        index_ = view_.count;
+        return;
+    }
+
+    region_ = view_.FindRegion(index_);
+
+    const ResultRegion& region = view_.regions[region_];
+    const uint8_t* data = view_.pool + region.data_offset;
+    uint64_t skip = index_ - region.first;
+
+    if (region.encoding == CGP_Result_Bitmap)
+    {
+        size_t byte = 0;
+
+        for (;; ++byte)
+        {
+            uint64_t bits = static_cast<uint64_t>(__builtin_popcount(data[byte]));
+
+            if (bits > skip)
+            {
+                break;
+            }
+
+            skip -= bits;
+        }
+
+        uint32_t bits = data[byte];
+
+        for (; skip > 0; --skip)
+        {
+            bits &= bits - 1;
+        }
+
+        cursor_ = static_cast<uint64_t>(byte) * 8 + __builtin_ctz(bits);
+        address_ = region.region_base + cursor_ * region.stride;
+        return;
+    }
+
+    cursor_ = 0;
+    address_ = region.region_base;
+
+    for (; skip > 0; --skip)
+    {
+        uint64_t delta = 0;
+        cursor_ += CGPReadVarint(data + cursor_, &delta);
+        address_ += delta;
+    }
+}
+
+/* Next hit, index_ + 1 < count */
+void CGPResultRange::Iterator::Step()
+{
+    ++index_;
+
+    const ResultRegion* region = &view_.regions[region_];
+
+    if (index_ == region->first + region->count)
+    {
+        region = &view_.regions[++region_];
+        cursor_ = 0;
+        address_ = region->region_base;
+        return;
+    }
+
+    const uint8_t* data = view_.pool + region->data_offset;
+
+    if (region->encoding == CGP_Result_Bitmap)
+    {
+        uint64_t slot = cursor_ + 1;
+        size_t byte = static_cast<size_t>(slot >> 3);
+        uint32_t bits = data[byte] & (0xFFu << (slot & 7));
+
+        while (!bits)
+        {
+            bits = data[++byte];
+        }
+
+        cursor_ = static_cast<uint64_t>(byte) * 8 + __builtin_ctz(bits);
+        address_ = region->region_base + cursor_ * region->stride;
+        return;
+    }
+
+    uint64_t delta = 0;
+    cursor_ += CGPReadVarint(data + cursor_, &delta);
+    address_ += delta;
+}
+
+CGPResultRange::Iterator& CGPResultRange::Iterator::operator++()
+{
+    if (index_ + 1 >= view_.count)
+    {
+        index_ = view_.count;
+        return *this;
+    }
+
+    Step();
+    return *this;
+}
+
+CGPResultRange::Iterator& CGPResultRange::Iterator::operator+=(difference_type n)
+{
+    size_t target = static_cast<size_t>(static_cast<difference_type>(index_) + n);
+
+    // short hops forward are cheaper stepped than sought
+    if (n > 0 && n <= 64 && target < view_.count && index_ < view_.count)
+    {
+        while (index_ < target)
+        {
+            Step();
+        }
+
+        return *this;
+    }
+
+    if (n != 0)
+    {
+        Seek(target);
+    }
+
+    return *this;
+}
+
+void CGPResultRange::Copy(size_t offset, size_t count, std::vector<uint64_t>& out) const
+{
+    if (offset >= view_.count)
+    {
+        return;
+    }
+
+    count = std::min(count, view_.count - offset);
+    out.reserve(out.size() + count);
+
+    Iterator it(view_, offset);
+
+    for (size_t i = 0; i < count; ++i, ++it)
+    {
+        out.push_back(*it);
+    }
+}
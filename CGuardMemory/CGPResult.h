@@ -0,0 +1,257 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPResult.h * * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPResult_h
+#define CGPResult_h
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+/* ResultRegion encodings */
+#define CGP_Result_Packed 0 // LEB128 deltas between consecutive hits
+#define CGP_Result_Bitmap 1 // one bit per `stride` bytes from region_base
+
+/* Hits per ResultRegion before a new entry is started, also the most a random access decodes */
+#define CGP_Result_Region_Hits (1u << 14)
+
+/* Gap between sorted addresses that starts a new ResultRegion in AppendAddresses */
+#define CGP_Result_Region_Gap (1u << 20)
+
+typedef struct _result_region {
+    uint64_t region_base;   // address of the first hit
+    uint64_t first;         // index of that hit in the whole result
+    uint64_t data_offset;   // encoded hits in Result::pool
+    uint32_t data_size;
+    uint32_t count;
+    uint8_t encoding;
+    uint8_t stride;
+} ResultRegion;
+
+/* Read-only window on a Result's storage, or on a mapped result file */
+typedef struct _result_view {
+    const ResultRegion* regions = nullptr;
+    size_t region_count = 0;
+    const uint8_t* pool = nullptr;
+    size_t count = 0;
+
+    /* fn(uint64_t address) returns false to stop, ForEach returns false if stopped */
+    template <typename Fn>
+    bool ForEachInRegion(const ResultRegion& region, Fn&& fn) const;
+    template <typename Fn>
+    bool ForEach(Fn&& fn) const;
+
+    /* Region holding hit index, index < count */
+    size_t FindRegion(size_t index) const;
+    /* Index of the first hit at or above address, count if there is none */
+    size_t LowerBound(uint64_t address) const;
+} ResultView;
+
+/*
+ * Random Access Result Range
+ * Non-owning, valid until the results it views change. Hits come out sorted
+ * and unique. A seek is a binary search over the regions plus the decode of
+ * at most CGP_Result_Region_Hits hits, a step is O(1).
+ */
+class CGPResultRange {
+public:
+    class Iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef uint64_t value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const uint64_t* pointer;
+        typedef uint64_t reference;   // decoded on the fly, there is nothing to refer to
+
+        Iterator() : view_(), index_(0), region_(0), cursor_(0), address_(0) {}
+
+        uint64_t operator*() const { return address_; }
+        uint64_t operator[](difference_type n) const { return *(*this + n); }
+
+        Iterator& operator++();
+        Iterator operator++(int) { Iterator it = *this; ++*this; return it; }
+        Iterator& operator--() { return *this -= 1; }
+        Iterator operator--(int) { Iterator it = *this; --*this; return it; }
+
+        Iterator& operator+=(difference_type n);
+        Iterator& operator-=(difference_type n) { return *this += -n; }
+        Iterator operator+(difference_type n) const { Iterator it = *this; return it += n; }
+        Iterator operator-(difference_type n) const { Iterator it = *this; return it -= n; }
+        difference_type operator-(const Iterator& other) const { return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_); }
+
+        bool operator==(const Iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+        bool operator<(const Iterator& other) const { return index_ < other.index_; }
+        bool operator>(const Iterator& other) const { return index_ > other.index_; }
+        bool operator<=(const Iterator& other) const { return index_ <= other.index_; }
+        bool operator>=(const Iterator& other) const { return index_ >= other.index_; }
+
+        size_t Index() const { return index_; }
+
+    private:
+        friend class CGPResultRange;
+
+        Iterator(const ResultView& view, size_t index);
+        void Seek(size_t index);
+        void Step();
+
+        ResultView view_;
+        size_t index_;
+        size_t region_;
+        uint64_t cursor_;   // next byte of a packed region, current slot of a bitmap region
+        uint64_t address_;
+    };
+
+    explicit CGPResultRange(const ResultView& view) : view_(view) {}
+
+    size_t size() const { return view_.count; }
+    bool empty() const { return view_.count == 0; }
+
+    Iterator begin() const { return Iterator(view_, 0); }
+    Iterator end() const { return Iterator(view_, view_.count); }
+
+    /* index < size() */
+    uint64_t operator[](size_t index) const { return *Iterator(view_, index); }
+
+    /* Appends up to count hits starting at hit offset */
+    void Copy(size_t offset, size_t count, std::vector<uint64_t>& out) const;
+
+private:
+    ResultView view_;
+};
+
+/*
+ * Scan results, one ResultRegion per scanned region with its hits encoded in
+ * a shared byte pool. Regions are appended in ascending address order, so
+ * walking them yields sorted, unique addresses. Every append must start
+ * above the last stored hit, debug builds assert it.
+ */
+typedef struct _result {
+    std::vector<ResultRegion> regions;
+    std::vector<uint8_t> pool;
+    size_t count = 0;
+
+    void Clear();
+
+    /* offsets are ascending and relative to base */
+    void Append(uint64_t base, const size_t* offsets, size_t n);
+    /* addresses are ascending */
+    void AppendAddresses(const uint64_t* addresses, size_t n);
+    /* addresses are ascending and stored as they are, without splitting on gaps */
+    void AppendRegion(const uint64_t* addresses, size_t n);
+    /* other starts above every address already stored */
+    void AppendResult(const _result& other);
+    void AppendResult(const ResultView& other);
+
+    ResultView View() const { return { regions.data(), regions.size(), pool.data(), count }; }
+
+    template <typename Fn>
+    bool ForEachInRegion(const ResultRegion& region, Fn&& fn) const { return View().ForEachInRegion(region, fn); }
+    template <typename Fn>
+    bool ForEach(Fn&& fn) const { return View().ForEach(fn); }
+} Result;
+
+/*
+ * Rewrites a Result in place. Call Keep() once per region, in region order,
+ * with the subset of its hits that survive, then Finish(). Every region must
+ * be decoded by the caller before its Keep() call.
+ */
+class CGPResultCompactor {
+public:
+    explicit CGPResultCompactor(Result& result);
+
+    void Keep(const uint64_t* addresses, size_t n);
+    void Finish();
+
+private:
+    Result& result_;
+    size_t regions_;
+    uint64_t pool_;
+    size_t count_;
+};
+
+static inline size_t CGPReadVarint(const uint8_t* data, uint64_t* value)
+{
+    uint64_t result = 0;
+    size_t i = 0;
+    int shift = 0;
+
+    do
+    {
+        result |= static_cast<uint64_t>(data[i] & 0x7F) << shift;
+        shift += 7;
+    } while (data[i++] & 0x80);
+
+    *value = result;
+    return i;
+}
+
+template <typename Fn>
+bool _result_view::ForEachInRegion(const ResultRegion& region, Fn&& fn) const
+{
+    const uint8_t* data = pool + region.data_offset;
+
+    if (region.encoding == CGP_Result_Bitmap)
+    {
+        for (uint32_t i = 0; i < region.data_size; ++i)
+        {
+            uint32_t bits = data[i];
+
+            while (bits)
+            {
+                uint64_t slot = static_cast<uint64_t>(i) * 8 + __builtin_ctz(bits);
+
+                if (!fn(region.region_base + slot * region.stride))
+                {
+                    return false;
+                }
+
+                bits &= bits - 1;
+            }
+        }
+
+        return true;
+    }
+
+    uint64_t address = region.region_base;
+    size_t pos = 0;
+
+    for (uint32_t i = 0; i < region.count; ++i)
+    {
+        if (i > 0)
+        {
+            uint64_t delta = 0;
+            pos += CGPReadVarint(data + pos, &delta);
+            address += delta;
+        }
+
+        if (!fn(address))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename Fn>
+bool _result_view::ForEach(Fn&& fn) const
+{
+    for (size_t i = 0; i < region_count; ++i)
+    {
+        if (!ForEachInRegion(regions[i], fn))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#endif /* CGPResult_h */
@@ -0,0 +1,248 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPResultFile.cpp * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPResultFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * File layout, host byte order
+ *   ResultFileHeader
+ *   region_count * ResultRegion    at regions_offset
+ *   pool_size bytes                at pool_offset, data_offset of every region is relative to it
+ */
+typedef struct _result_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t region_size;   // sizeof(ResultRegion) of the writer
+    uint64_t pid;
+    uint64_t start_time;
+    uint64_t count;
+    uint64_t region_count;
+    uint64_t regions_offset;
+    uint64_t pool_offset;
+    uint64_t pool_size;
+} ResultFileHeader;
+
+static inline uint64_t AlignUp(uint64_t value)
+{
+    return (value + CGP_ResultFile_Align - 1) & ~static_cast<uint64_t>(CGP_ResultFile_Align - 1);
+}
+
+static bool WritePadding(FILE* file, uint64_t from, uint64_t to)
+{
+    static const uint8_t zero[CGP_ResultFile_Align] = {};
+    return to == from || fwrite(zero, static_cast<size_t>(to - from), 1, file) == 1;
+}
+
+/* Decodes one region of an untrusted pool within data_size, last is set to its highest hit */
+static bool CheckRegion(const ResultRegion& region, const uint8_t* data, uint64_t* last)
+{
+    if (region.encoding == CGP_Result_Bitmap)
+    {
+        uint64_t hits = 0;
+        uint64_t top = 0;
+
+        for (uint32_t i = 0; i < region.data_size; ++i)
+        {
+            if (data[i])
+            {
+                hits += static_cast<uint64_t>(__builtin_popcount(data[i]));
+                top = static_cast<uint64_t>(i) * 8 + (31 - __builtin_clz(data[i]));
+            }
+        }
+
+        // region_base is the first hit, so slot 0 is set
+        if (hits != region.count || !(data[0] & 1) || top > (UINT64_MAX - region.region_base) / region.stride)
+        {
+            return false;
+        }
+
+        *last = region.region_base + top * region.stride;
+        return true;
+    }
+
+    uint64_t address = region.region_base;
+    size_t pos = 0;
+
+    for (uint32_t i = 1; i < region.count; ++i)
+    {
+        uint64_t delta = 0;
+        int shift = 0;
+        uint8_t byte;
+
+        do
+        {
+            if (pos == region.data_size || shift > 63)
+            {
+                return false;
+            }
+
+            byte = data[pos++];
+            delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        if (delta == 0 || delta > UINT64_MAX - address)
+        {
+            return false;
+        }
+
+        address += delta;
+    }
+
+    *last = address;
+    return pos == region.data_size;
+}
+
+#pragma mark - CGPResultFile Implementation -
+
+bool CGPResultFile::Save(const std::string& path, const ResultView& result, const TargetIdentity& identity)
+{
+    uint64_t poolSize = 0;
+
+    for (size_t i = 0; i < result.region_count; ++i)
+    {
+        poolSize = std::max<uint64_t>(poolSize, result.regions[i].data_offset + result.regions[i].data_size);
+    }
+
+    ResultFileHeader header = {};
+    header.magic = CGP_ResultFile_Magic;
+    header.version = CGP_ResultFile_Version;
+    header.header_size = sizeof(ResultFileHeader);
+    header.region_size = sizeof(ResultRegion);
+    header.pid = identity.pid;
+    header.start_time = identity.start_time;
+    header.count = result.count;
+    header.region_count = result.region_count;
+    header.regions_offset = AlignUp(sizeof(ResultFileHeader));
+    header.pool_offset = AlignUp(header.regions_offset + header.region_count * sizeof(ResultRegion));
+    header.pool_size = poolSize;
+
+    std::string temporary = path + ".tmp";
+
+    {
+        std::unique_ptr<FILE, int (*)(FILE*)> file(fopen(temporary.c_str(), "wb"), fclose);
+
+        if (!file)
+        {
+            return false;
+        }
+
+        uint64_t tableEnd = header.regions_offset + header.region_count * sizeof(ResultRegion);
+
+        bool ok = fwrite(&header, sizeof(header), 1, file.get()) == 1 &&
+                  WritePadding(file.get(), sizeof(header), header.regions_offset) &&
+                  (result.region_count == 0 || fwrite(result.regions, sizeof(ResultRegion), result.region_count, file.get()) == result.region_count) &&
+                  WritePadding(file.get(), tableEnd, header.pool_offset) &&
+                  (poolSize == 0 || fwrite(result.pool, static_cast<size_t>(poolSize), 1, file.get()) == 1);
+
+        if (!ok || fflush(file.get()) != 0)
+        {
+            file.reset();
+            remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    if (rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+CGPResultFile::CGPResultFile(const std::string& path)
+    : map_(nullptr), mapSize_(0), identity_({ 0, 0 })
+{
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < sizeof(ResultFileHeader))
+    {
+        close(fd);
+        return;
+    }
+
+    mapSize_ = static_cast<size_t>(info.st_size);
+    void* map = mmap(nullptr, mapSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+
+    if (map == MAP_FAILED)
+    {
+        mapSize_ = 0;
+        return;
+    }
+
+    const uint8_t* base = static_cast<const uint8_t*>(map);
+    ResultFileHeader header;
+    memcpy(&header, base, sizeof(header));
+
+    bool valid = header.magic == CGP_ResultFile_Magic && header.version == CGP_ResultFile_Version &&
+                 header.header_size == sizeof(ResultFileHeader) && header.region_size == sizeof(ResultRegion) &&
+                 header.regions_offset % CGP_ResultFile_Align == 0 && header.regions_offset <= mapSize_ &&
+                 header.region_count <= (mapSize_ - header.regions_offset) / sizeof(ResultRegion) &&
+                 header.pool_offset <= mapSize_ && header.pool_size <= mapSize_ - header.pool_offset;
+
+    const ResultRegion* regions = reinterpret_cast<const ResultRegion*>(base + (valid ? header.regions_offset : 0));
+    const uint8_t* pool = base + (valid ? header.pool_offset : 0);
+    uint64_t count = 0;
+    uint64_t last = 0;
+
+    // one pass over the pool, readers trust every region to decode within data_size in ascending order
+    for (uint64_t i = 0; valid && i < header.region_count; ++i)
+    {
+        const ResultRegion& region = regions[i];
+
+        valid = region.count > 0 && region.first == count && region.data_offset <= header.pool_size &&
+                region.data_size <= header.pool_size - region.data_offset &&
+                (region.encoding == CGP_Result_Packed || (region.encoding == CGP_Result_Bitmap && region.stride > 0 && region.data_size > 0)) &&
+                (i == 0 || region.region_base > last) &&
+                CheckRegion(region, pool + region.data_offset, &last);
+        count += region.count;
+    }
+
+    if (!valid || count != header.count)
+    {
+        munmap(map, mapSize_);
+        mapSize_ = 0;
+        return;
+    }
+
+    map_ = map;
+    identity_ = { header.pid, header.start_time };
+
+    view_.regions = regions;
+    view_.region_count = static_cast<size_t>(header.region_count);
+    view_.pool = base + header.pool_offset;
+    view_.count = static_cast<size_t>(header.count);
+}
+
+CGPResultFile::~CGPResultFile()
+{
+    if (map_)
+    {
+        munmap(map_, mapSize_);
+    }
+}
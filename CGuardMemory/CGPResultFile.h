@@ -0,0 +1,55 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPResultFile.h * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPResultFile_h
+#define CGPResultFile_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "CGPBackend.h"
+#include "CGPResult.h"
+
+#define CGP_ResultFile_Magic 0x52504743 // "CGPR"
+#define CGP_ResultFile_Version 2 // 2 added ResultRegion::first
+
+/* Region table and pool start on this boundary, so both are usable straight from the mapping */
+#define CGP_ResultFile_Align 64
+
+/*
+ * Mapped Result File
+ * Header, ResultRegion table and encoded pool exactly as a Result holds
+ * them, in host byte order. Opening maps the file read-only and decodes the
+ * pool once, so a damaged table or pool is rejected before anything walks it.
+ */
+class CGPResultFile {
+public:
+    /* Written to a temporary file and renamed over path */
+    static bool Save(const std::string& path, const ResultView& result, const TargetIdentity& identity);
+
+    explicit CGPResultFile(const std::string& path);
+    ~CGPResultFile();
+
+    CGPResultFile(const CGPResultFile&) = delete;
+    CGPResultFile& operator=(const CGPResultFile&) = delete;
+
+    bool IsOpen() const { return map_ != nullptr; }
+    const TargetIdentity& Identity() const { return identity_; }
+
+    /* Valid while the file is open */
+    ResultView View() const { return view_; }
+
+private:
+    void* map_;
+    size_t mapSize_;
+    TargetIdentity identity_;
+    ResultView view_;
+};
+
+#endif /* CGPResultFile_h */
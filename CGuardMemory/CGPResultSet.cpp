@@ -0,0 +1,216 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPResultSet.cpp  * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPResultSet.h"
+
+#include <algorithm>
+#include <vector>
+
+/* Sorted addresses on their way into a Result, encoded a region at a time */
+class ResultSink {
+public:
+    explicit ResultSink(Result& out) : out_(out)
+    {
+        buffer_.reserve(CGP_Result_Region_Hits);
+    }
+
+    ~ResultSink() { Flush(); }
+
+    void Emit(uint64_t address)
+    {
+        buffer_.push_back(address);
+
+        if (buffer_.size() == CGP_Result_Region_Hits)
+        {
+            Flush();
+        }
+    }
+
+    void Flush()
+    {
+        if (!buffer_.empty())
+        {
+            out_.AppendAddresses(buffer_.data(), buffer_.size());
+            buffer_.clear();
+        }
+    }
+
+private:
+    Result& out_;
+    std::vector<uint64_t> buffer_;
+};
+
+#pragma mark - CGPResultSet Implementation -
+
+void CGPResultSet::Merge(const ResultView& a, size_t aFrom, size_t aTo, const ResultView& b, size_t bFrom, size_t bTo,
+                         CGPResultSetOp op, Result& out)
+{
+    CGPResultRange left(a);
+    CGPResultRange right(b);
+
+    auto x = left.begin() + static_cast<ptrdiff_t>(aFrom);
+    auto y = right.begin() + static_cast<ptrdiff_t>(bFrom);
+    size_t i = aFrom;
+    size_t j = bFrom;
+
+    ResultSink sink(out);
+
+    while (i < aTo && j < bTo)
+    {
+        uint64_t p = *x;
+        uint64_t q = *y;
+
+        if (p < q)
+        {
+            if (op != CGPResultSetOp::Intersection)
+            {
+                sink.Emit(p);
+            }
+
+            ++x;
+            ++i;
+        }
+        else if (q < p)
+        {
+            if (op == CGPResultSetOp::Union)
+            {
+                sink.Emit(q);
+            }
+
+            ++y;
+            ++j;
+        }
+        else
+        {
+            if (op != CGPResultSetOp::Difference)
+            {
+                sink.Emit(p);
+            }
+
+            ++x;
+            ++y;
+            ++i;
+            ++j;
+        }
+    }
+
+    for (; i < aTo && op != CGPResultSetOp::Intersection; ++i, ++x)
+    {
+        sink.Emit(*x);
+    }
+
+    for (; j < bTo && op == CGPResultSetOp::Union; ++j, ++y)
+    {
+        sink.Emit(*y);
+    }
+}
+
+void CGPResultSet::Combine(const ResultView& a, const ResultView& b, CGPResultSetOp op, Result& out, CGPThreadPool* pool)
+{
+    out.Clear();
+
+    // one side empty, the answer is a copy of the encoded regions or nothing
+    if (a.count == 0 || b.count == 0)
+    {
+        if (op == CGPResultSetOp::Union)
+        {
+            out.AppendResult(a.count ? a : b);
+        }
+        else if (op == CGPResultSetOp::Difference)
+        {
+            out.AppendResult(a);
+        }
+
+        return;
+    }
+
+    size_t total = a.count + b.count;
+    size_t slices = 1;
+
+    if (pool && pool->Size() > 1)
+    {
+        slices = std::min(pool->Size() * 4, total / CGP_ResultSet_Slice_Hits);
+    }
+
+    if (slices <= 1)
+    {
+        Merge(a, 0, a.count, b, 0, b.count, op, out);
+        return;
+    }
+
+    // slices are cut at hits of the larger side, both sides split at the same addresses
+    const ResultView& larger = (a.count >= b.count) ? a : b;
+    CGPResultRange range(larger);
+
+    std::vector<size_t> aBounds(slices + 1);
+    std::vector<size_t> bBounds(slices + 1);
+    aBounds[slices] = a.count;
+    bBounds[slices] = b.count;
+
+    for (size_t slice = 1; slice < slices; ++slice)
+    {
+        uint64_t pivot = range[slice * larger.count / slices];
+        aBounds[slice] = a.LowerBound(pivot);
+        bBounds[slice] = b.LowerBound(pivot);
+    }
+
+    std::vector<Result> parts(slices);
+
+    pool->Run(slices, [&](size_t slice, size_t)
+    {
+        Merge(a, aBounds[slice], aBounds[slice + 1], b, bBounds[slice], bBounds[slice + 1], op, parts[slice]);
+    });
+
+    for (Result& part : parts)
+    {
+        out.AppendResult(part);
+        part = Result(); // released as it is copied, the peak stays one part above the output
+    }
+}
+
+void CGPResultSet::Shift(const ResultView& a, int64_t delta, Result& out)
+{
+    out.Clear();
+
+    uint64_t step = static_cast<uint64_t>(delta);
+    size_t from = 0;
+    size_t to = a.count;
+
+    if (delta < 0)
+    {
+        from = a.LowerBound(0 - step);
+    }
+    else if (delta > 0)
+    {
+        to = a.LowerBound(UINT64_MAX - step + 1);
+    }
+
+    // hits are stored relative to their region base, moving the bases moves every hit
+    if (from == 0 && to == a.count)
+    {
+        out.AppendResult(a);
+
+        for (ResultRegion& region : out.regions)
+        {
+            region.region_base += step;
+        }
+
+        return;
+    }
+
+    // some hits wrap, the rest are re-encoded without them
+    CGPResultRange range(a);
+    auto it = range.begin() + static_cast<ptrdiff_t>(from);
+
+    ResultSink sink(out);
+
+    for (size_t i = from; i < to; ++i, ++it)
+    {
+        sink.Emit(*it + step);
+    }
+}
@@ -0,0 +1,47 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPResultSet.h  * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPResultSet_h
+#define CGPResultSet_h
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CGPResult.h"
+#include "CGPThreadPool.h"
+
+/* Hits per merge slice before a combine is split across the pool */
+#define CGP_ResultSet_Slice_Hits (1u << 18)
+
+enum class CGPResultSetOp {
+    Union,          // a or b
+    Intersection,   // a and b
+    Difference,     // a and not b
+};
+
+/*
+ * Result Set Algebra
+ * Linear merges of two sorted results read straight from their encoded
+ * regions. Hits pass through one region sized buffer per slice on their way
+ * to the output, they are never held one object each. Large inputs are cut
+ * at the same addresses into slices merged on the pool and appended in order.
+ */
+class CGPResultSet {
+public:
+    /* out = a op b, out must not be a or b */
+    static void Combine(const ResultView& a, const ResultView& b, CGPResultSetOp op, Result& out, CGPThreadPool* pool);
+
+    /* out = a + delta, hits that would wrap around the address space are dropped */
+    static void Shift(const ResultView& a, int64_t delta, Result& out);
+
+private:
+    static void Merge(const ResultView& a, size_t aFrom, size_t aTo, const ResultView& b, size_t bFrom, size_t bTo,
+                      CGPResultSetOp op, Result& out);
+};
+
+#endif /* CGPResultSet_h */
@@ -0,0 +1,830 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPScanKernel.cpp * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPScanKernel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CGP_KERNEL_X86 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CGP_KERNEL_NEON 1
+#endif
+
+typedef void (*FindAllFn)(const uint8_t* data, size_t size, const uint8_t* needle, size_t len, std::vector<size_t>& hits);
+typedef size_t (*MismatchFn)(const uint8_t* a, const uint8_t* b, size_t size, size_t from);
+
+#pragma mark - Scalar Kernel -
+
+static void ScanTail(const uint8_t* data, size_t size, const uint8_t* needle, size_t len,
+                     size_t from, std::vector<size_t>& hits)
+{
+    for (size_t i = from; i + len <= size; ++i)
+    {
+        if (data[i] == needle[0] && memcmp(data + i, needle, len) == 0)
+        {
+            hits.push_back(i);
+        }
+    }
+}
+
+static void FindAllScalar(const uint8_t* data, size_t size, const uint8_t* needle, size_t len, std::vector<size_t>& hits)
+{
+    if (size < len)
+    {
+        return;
+    }
+
+    const uint8_t* cursor = data;
+    const uint8_t* last = data + (size - len);
+
+    while (cursor <= last)
+    {
+        cursor = static_cast<const uint8_t*>(memchr(cursor, needle[0], static_cast<size_t>(last - cursor) + 1));
+
+        if (!cursor)
+        {
+            break;
+        }
+
+        if (memcmp(cursor, needle, len) == 0)
+        {
+            hits.push_back(static_cast<size_t>(cursor - data));
+        }
+
+        ++cursor;
+    }
+}
+
+/* Word at a time, the byte is found once a word differs */
+static size_t MismatchScalar(const uint8_t* a, const uint8_t* b, size_t size, size_t from)
+{
+    size_t i = from;
+
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t x, y;
+        memcpy(&x, a + i, sizeof(x));
+        memcpy(&y, b + i, sizeof(y));
+
+        if (x != y)
+        {
+            break;
+        }
+    }
+
+    for (; i < size; ++i)
+    {
+        if (a[i] != b[i])
+        {
+            return i;
+        }
+    }
+
+    return size;
+}
+
+#if defined(CGP_KERNEL_X86)
+
+#pragma mark - SSE2 Kernel -
+
+template <size_t N>
+static void ScanExactSSE2(const uint8_t* data, size_t size, const uint8_t* needle, std::vector<size_t>& hits)
+{
+    __m128i bytes[N];
+
+    for (size_t k = 0; k < N; ++k)
+    {
+        bytes[k] = _mm_set1_epi8(static_cast<char>(needle[k]));
+    }
+
+    size_t i = 0;
+
+    for (; i + 16 + N - 1 <= size; i += 16)
+    {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), bytes[0]);
+
+        for (size_t k = 1; k < N; ++k)
+        {
+            eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + k)), bytes[k]));
+        }
+
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(eq));
+
+        while (mask)
+        {
+            hits.push_back(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    ScanTail(data, size, needle, N, i, hits);
+}
+
+static void ScanAnchorSSE2(const uint8_t* data, size_t size, const uint8_t* needle, size_t len, std::vector<size_t>& hits)
+{
+    const __m128i first = _mm_set1_epi8(static_cast<char>(needle[0]));
+    const __m128i last = _mm_set1_epi8(static_cast<char>(needle[len - 1]));
+
+    size_t i = 0;
+
+    for (; i + 16 + len - 1 <= size; i += 16)
+    {
+        __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), first),
+                                   _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + len - 1)), last));
+
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(eq));
+
+        while (mask)
+        {
+            size_t at = i + __builtin_ctz(mask);
+
+            if (memcmp(data + at + 1, needle + 1, len - 2) == 0)
+            {
+                hits.push_back(at);
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    ScanTail(data, size, needle, len, i, hits);
+}
+
+static void FindAllSSE2(const uint8_t* data, size_t size, const uint8_t* needle, size_t len, std::vector<size_t>& hits)
+{
+    switch (len)
+    {
+        case 1: ScanExactSSE2<1>(data, size, needle, hits); break;
+        case 2: ScanExactSSE2<2>(data, size, needle, hits); break;
+        case 4: ScanExactSSE2<4>(data, size, needle, hits); break;
+        case 8: ScanExactSSE2<8>(data, size, needle, hits); break;
+        default: ScanAnchorSSE2(data, size, needle, len, hits); break;
+    }
+}
+
+static size_t MismatchSSE2(const uint8_t* a, const uint8_t* b, size_t size, size_t from)
+{
+    size_t i = from;
+
+    // unchanged data is the common case, four vectors are tested per branch
+    for (; i + 64 <= size; i += 64)
+    {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+
+        for (size_t k = 16; k < 64; k += 16)
+        {
+            eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + k)),
+                                                  _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + k))));
+        }
+
+        if (_mm_movemask_epi8(eq) != 0xFFFF)
+        {
+            break;
+        }
+    }
+
+    for (; i + 16 <= size; i += 16)
+    {
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                                                               _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)))));
+
+        if (mask != 0xFFFF)
+        {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+
+    return MismatchScalar(a, b, size, i);
+}
+
+#pragma mark - AVX2 Kernel -
+
+template <size_t N>
+__attribute__((target("avx2")))
+static void ScanExactAVX2(const uint8_t* data, size_t size, const uint8_t* needle, std::vector<size_t>& hits)
+{
+    __m256i bytes[N];
+
+    for (size_t k = 0; k < N; ++k)
+    {
+        bytes[k] = _mm256_set1_epi8(static_cast<char>(needle[k]));
+    }
+
+    size_t i = 0;
+
+    for (; i + 32 + N - 1 <= size; i += 32)
+    {
+        __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), bytes[0]);
+
+        for (size_t k = 1; k < N; ++k)
+        {
+            eq = _mm256_and_si256(eq, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + k)), bytes[k]));
+        }
+
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+
+        while (mask)
+        {
+            hits.push_back(i + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    ScanTail(data, size, needle, N, i, hits);
+}
+
+__attribute__((target("avx2")))
+static void ScanAnchorAVX2(const uint8_t* data, size_t size, const uint8_t* needle, size_t len, std::vector<size_t>& hits)
+{
+    const __m256i first = _mm256_set1_epi8(static_cast<char>(needle[0]));
+    const __m256i last = _mm256_set1_epi8(static_cast<char>(needle[len - 1]));
+
+    size_t i = 0;
+
+    for (; i + 32 + len - 1 <= size; i += 32)
+    {
+        __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), first),
+                                      _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + len - 1)), last));
+
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+
+        while (mask)
+        {
+            size_t at = i + __builtin_ctz(mask);
+
+            if (memcmp(data + at + 1, needle + 1, len - 2) == 0)
+            {
+                hits.push_back(at);
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    ScanTail(data, size, needle, len, i, hits);
+}
+
+__attribute__((target("avx2")))
+static void FindAllAVX2(const uint8_t* data, size_t size, const uint8_t* needle, size_t len, std::vector<size_t>& hits)
+{
+    switch (len)
+    {
+        case 1: ScanExactAVX2<1>(data, size, needle, hits); break;
+        case 2: ScanExactAVX2<2>(data, size, needle, hits); break;
+        case 4: ScanExactAVX2<4>(data, size, needle, hits); break;
+        case 8: ScanExactAVX2<8>(data, size, needle, hits); break;
+        default: ScanAnchorAVX2(data, size, needle, len, hits); break;
+    }
+}
+
+__attribute__((target("avx2")))
+static size_t MismatchAVX2(const uint8_t* a, const uint8_t* b, size_t size, size_t from)
+{
+    size_t i = from;
+
+    for (; i + 128 <= size; i += 128)
+    {
+        __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+
+        for (size_t k = 32; k < 128; k += 32)
+        {
+            eq = _mm256_and_si256(eq, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + k)),
+                                                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + k))));
+        }
+
+        if (static_cast<uint32_t>(_mm256_movemask_epi8(eq)) != 0xFFFFFFFFu)
+        {
+            break;
+        }
+    }
+
+    for (; i + 32 <= size; i += 32)
+    {
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                                                                     _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)))));
+
+        if (mask != 0xFFFFFFFFu)
+        {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+
+    return MismatchScalar(a, b, size, i);
+}
+
+#elif defined(CGP_KERNEL_NEON)
+
+#pragma mark - NEON Kernel -
+
+/* 4 bits per lane after the narrowing shift, keep one so ctz / 4 is the lane */
+static inline uint64_t MaskNEON(uint8x16_t eq)
+{
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ULL;
+}
+
+template <size_t N>
+static void ScanExactNEON(const uint8_t* data, size_t size, const uint8_t* needle, std::vector<size_t>& hits)
+{
+    uint8x16_t bytes[N];
+
+    for (size_t k = 0; k < N; ++k)
+    {
+        bytes[k] = vdupq_n_u8(needle[k]);
+    }
+
+    size_t i = 0;
+
+    for (; i + 16 + N - 1 <= size; i += 16)
+    {
+        uint8x16_t eq = vceqq_u8(vld1q_u8(data + i), bytes[0]);
+
+        for (size_t k = 1; k < N; ++k)
+        {
+            eq = vandq_u8(eq, vceqq_u8(vld1q_u8(data + i + k), bytes[k]));
+        }
+
+        uint64_t mask = MaskNEON(eq);
+
+        while (mask)
+        {
+            hits.push_back(i + (__builtin_ctzll(mask) >> 2));
+            mask &= mask - 1;
+        }
+    }
+
+    ScanTail(data, size, needle, N, i, hits);
+}
+
+static void ScanAnchorNEON(const uint8_t* data, size_t size, const uint8_t* needle, size_t len, std::vector<size_t>& hits)
+{
+    const uint8x16_t first = vdupq_n_u8(needle[0]);
+    const uint8x16_t last = vdupq_n_u8(needle[len - 1]);
+
+    size_t i = 0;
+
+    for (; i + 16 + len - 1 <= size; i += 16)
+    {
+        uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(data + i), first),
+                                 vceqq_u8(vld1q_u8(data + i + len - 1), last));
+
+        uint64_t mask = MaskNEON(eq);
+
+        while (mask)
+        {
+            size_t at = i + (__builtin_ctzll(mask) >> 2);
+
+            if (memcmp(data + at + 1, needle + 1, len - 2) == 0)
+            {
+                hits.push_back(at);
+            }
+
+            mask &= mask - 1;
+        }
+    }
+
+    ScanTail(data, size, needle, len, i, hits);
+}
+
+static void FindAllNEON(const uint8_t* data, size_t size, const uint8_t* needle, size_t len, std::vector<size_t>& hits)
+{
+    switch (len)
+    {
+        case 1: ScanExactNEON<1>(data, size, needle, hits); break;
+        case 2: ScanExactNEON<2>(data, size, needle, hits); break;
+        case 4: ScanExactNEON<4>(data, size, needle, hits); break;
+        case 8: ScanExactNEON<8>(data, size, needle, hits); break;
+        default: ScanAnchorNEON(data, size, needle, len, hits); break;
+    }
+}
+
+static size_t MismatchNEON(const uint8_t* a, const uint8_t* b, size_t size, size_t from)
+{
+    size_t i = from;
+
+    for (; i + 64 <= size; i += 64)
+    {
+        uint8x16_t eq = vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+
+        for (size_t k = 16; k < 64; k += 16)
+        {
+            eq = vandq_u8(eq, vceqq_u8(vld1q_u8(a + i + k), vld1q_u8(b + i + k)));
+        }
+
+        if (MaskNEON(vmvnq_u8(eq)) != 0)
+        {
+            break;
+        }
+    }
+
+    for (; i + 16 <= size; i += 16)
+    {
+        uint64_t mask = MaskNEON(vmvnq_u8(vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i))));
+
+        if (mask)
+        {
+            return i + __builtin_ctzll(mask) / 4;
+        }
+    }
+
+    return MismatchScalar(a, b, size, i);
+}
+
+#endif
+
+#pragma mark - Typed Kernels -
+
+/* 128-bit vectors through the compiler vector extension, SSE2 on x86 and NEON on arm64 */
+#define CGP_Value_Vector 16
+template <typename T>
+static inline T LoadValue(const uint8_t* data)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+/* Between and EqualEpsilon both become an inclusive [lo, hi] range, integer bounds saturate */
+template <typename T, CGPCompare P>
+static inline void LoadOperands(const uint8_t* value, const uint8_t* bound, T* lo, T* hi)
+{
+    T a = LoadValue<T>(value);
+    T b = (P == CGPCompare::Between || P == CGPCompare::EqualEpsilon) ? LoadValue<T>(bound) : T();
+
+    if (P != CGPCompare::EqualEpsilon)
+    {
+        *lo = a;
+        *hi = b;
+        return;
+    }
+
+    if constexpr (std::is_integral<T>::value)
+    {
+        typedef std::numeric_limits<T> Limits;
+
+        if constexpr (std::is_signed<T>::value)
+        {
+            if (b < 0)
+            { // empty range
+                *lo = Limits::max();
+                *hi = Limits::min();
+                return;
+            }
+        }
+
+        *lo = (a < static_cast<T>(Limits::min() + b)) ? Limits::min() : static_cast<T>(a - b);
+        *hi = (a > static_cast<T>(Limits::max() - b)) ? Limits::max() : static_cast<T>(a + b);
+    }
+    else
+    {
+        *lo = a - b;
+        *hi = a + b;
+    }
+}
+
+/* Scalar and vector operands alike, comparisons yield a bool or a lane mask */
+template <CGPCompare P, typename V>
+static inline auto TestValue(V x, V lo, V hi)
+{
+    if constexpr (P == CGPCompare::Equal)
+    {
+        return x == lo;
+    }
+    else if constexpr (P == CGPCompare::NotEqual)
+    {
+        return x != lo;
+    }
+    else if constexpr (P == CGPCompare::Less)
+    {
+        return x < lo;
+    }
+    else if constexpr (P == CGPCompare::Greater)
+    {
+        return x > lo;
+    }
+    else
+    { // Between, EqualEpsilon
+        return (x >= lo) & (x <= hi);
+    }
+}
+
+/* Values packed back to back from data + first */
+template <typename T, CGPCompare P>
+static void ScanPacked(const uint8_t* data, size_t size, size_t first, const uint8_t* value, const uint8_t* bound,
+                       std::vector<size_t>& hits)
+{
+    typedef T Vector __attribute__((vector_size(CGP_Value_Vector)));
+    constexpr size_t Lanes = CGP_Value_Vector / sizeof(T);
+
+    if (size < first + sizeof(T))
+    {
+        return;
+    }
+
+    T lo;
+    T hi;
+    LoadOperands<T, P>(value, bound, &lo, &hi);
+
+    Vector vlo;
+    Vector vhi;
+
+    for (size_t k = 0; k < Lanes; ++k)
+    {
+        vlo[k] = lo;
+        vhi[k] = hi;
+    }
+
+    const uint8_t* base = data + first;
+    size_t count = (size - first) / sizeof(T);
+    size_t i = 0;
+
+    // four vectors per step, lanes are only extracted when one of them matched
+    for (; i + 4 * Lanes <= count; i += 4 * Lanes)
+    {
+        Vector x[4];
+        memcpy(x, base + i * sizeof(T), sizeof(x));
+
+        auto m0 = TestValue<P>(x[0], vlo, vhi);
+        auto m1 = TestValue<P>(x[1], vlo, vhi);
+        auto m2 = TestValue<P>(x[2], vlo, vhi);
+        auto m3 = TestValue<P>(x[3], vlo, vhi);
+        auto any = m0 | m1 | m2 | m3;
+
+        uint64_t bits[2];
+        memcpy(bits, &any, sizeof(bits));
+
+        if ((bits[0] | bits[1]) == 0)
+        {
+            continue;
+        }
+
+        for (size_t k = 0; k < 4 * Lanes; ++k)
+        {
+            if (TestValue<P>(LoadValue<T>(base + (i + k) * sizeof(T)), lo, hi))
+            {
+                hits.push_back(first + (i + k) * sizeof(T));
+            }
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        if (TestValue<P>(LoadValue<T>(base + i * sizeof(T)), lo, hi))
+        {
+            hits.push_back(first + i * sizeof(T));
+        }
+    }
+}
+
+/*
+ * Strides are powers of two. A stride below the value width runs one packed
+ * pass per phase and merges them back into address order, a wider one
+ * drops the packed hits that fall between strides.
+ */
+template <typename T, CGPCompare P>
+static void ScanValues(const uint8_t* data, size_t size, size_t first, size_t stride, const uint8_t* value,
+                       const uint8_t* bound, std::vector<size_t>& hits)
+{
+    size_t from = hits.size();
+
+    if (stride >= sizeof(T))
+    {
+        ScanPacked<T, P>(data, size, first, value, bound, hits);
+
+        if (stride > sizeof(T))
+        {
+            hits.erase(std::remove_if(hits.begin() + from, hits.end(),
+                                      [&](size_t offset) { return (offset - first) % stride != 0; }),
+                       hits.end());
+        }
+
+        return;
+    }
+
+    for (size_t phase = 0; phase < sizeof(T); phase += stride)
+    {
+        size_t middle = hits.size();
+        ScanPacked<T, P>(data, size, first + phase, value, bound, hits);
+        std::inplace_merge(hits.begin() + from, hits.begin() + middle, hits.end());
+    }
+}
+
+template <typename T, CGPCompare P>
+static bool TestOne(const uint8_t* data, const uint8_t* value, const uint8_t* bound)
+{
+    T lo;
+    T hi;
+    LoadOperands<T, P>(value, bound, &lo, &hi);
+
+    return TestValue<P>(LoadValue<T>(data), lo, hi);
+}
+
+template <typename T>
+static void SelectPredicate(CGPCompare predicate, CGPValueScanFn* scan, CGPValueTestFn* test)
+{
+    switch (predicate)
+    {
+        case CGPCompare::Equal:
+            *scan = ScanValues<T, CGPCompare::Equal>;
+            *test = TestOne<T, CGPCompare::Equal>;
+            break;
+        case CGPCompare::NotEqual:
+            *scan = ScanValues<T, CGPCompare::NotEqual>;
+            *test = TestOne<T, CGPCompare::NotEqual>;
+            break;
+        case CGPCompare::Less:
+            *scan = ScanValues<T, CGPCompare::Less>;
+            *test = TestOne<T, CGPCompare::Less>;
+            break;
+        case CGPCompare::Greater:
+            *scan = ScanValues<T, CGPCompare::Greater>;
+            *test = TestOne<T, CGPCompare::Greater>;
+            break;
+        case CGPCompare::Between:
+            *scan = ScanValues<T, CGPCompare::Between>;
+            *test = TestOne<T, CGPCompare::Between>;
+            break;
+        case CGPCompare::EqualEpsilon:
+            *scan = ScanValues<T, CGPCompare::EqualEpsilon>;
+            *test = TestOne<T, CGPCompare::EqualEpsilon>;
+            break;
+    }
+}
+
+static void SelectValueKernel(CGPValueType type, CGPCompare predicate, CGPValueScanFn* scan, CGPValueTestFn* test)
+{
+    switch (type)
+    {
+        case CGPValueType::SByte:  SelectPredicate<int8_t>(predicate, scan, test); break;
+        case CGPValueType::UByte:  SelectPredicate<uint8_t>(predicate, scan, test); break;
+        case CGPValueType::SShort: SelectPredicate<int16_t>(predicate, scan, test); break;
+        case CGPValueType::UShort: SelectPredicate<uint16_t>(predicate, scan, test); break;
+        case CGPValueType::SInt:   SelectPredicate<int32_t>(predicate, scan, test); break;
+        case CGPValueType::UInt:   SelectPredicate<uint32_t>(predicate, scan, test); break;
+        case CGPValueType::SLong:  SelectPredicate<int64_t>(predicate, scan, test); break;
+        case CGPValueType::ULong:  SelectPredicate<uint64_t>(predicate, scan, test); break;
+        case CGPValueType::Float:  SelectPredicate<float>(predicate, scan, test); break;
+        case CGPValueType::Double: SelectPredicate<double>(predicate, scan, test); break;
+    }
+}
+
+#pragma mark - CGPScanKernel Implementation -
+
+static FindAllFn SelectKernel(const char** name)
+{
+#if defined(CGP_KERNEL_X86)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *name = "avx2";
+        return FindAllAVX2;
+    }
+
+    *name = "sse2";
+    return FindAllSSE2;
+#elif defined(CGP_KERNEL_NEON)
+    *name = "neon";
+    return FindAllNEON;
+#else
+    *name = "scalar";
+    return FindAllScalar;
+#endif
+}
+
+static MismatchFn SelectMismatch()
+{
+#if defined(CGP_KERNEL_X86)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? MismatchAVX2 : MismatchSSE2;
+#elif defined(CGP_KERNEL_NEON)
+    return MismatchNEON;
+#else
+    return MismatchScalar;
+#endif
+}
+
+static FindAllFn ActiveKernel(const char** name = nullptr)
+{
+    static const char* kernelName = nullptr;
+    static const FindAllFn kernel = SelectKernel(&kernelName);
+
+    if (name)
+    {
+        *name = kernelName;
+    }
+
+    return kernel;
+}
+
+void CGPScanKernel::FindAll(const uint8_t* data, size_t size, const void* needle, size_t len, std::vector<size_t>& hits)
+{
+    if (!data || !needle || len == 0 || size < len)
+    {
+        return;
+    }
+
+    if (size < 64)
+    { // not worth the vector setup
+        FindAllScalar(data, size, static_cast<const uint8_t*>(needle), len, hits);
+        return;
+    }
+
+    ActiveKernel()(data, size, static_cast<const uint8_t*>(needle), len, hits);
+}
+
+void CGPScanKernel::FindAligned(const uint8_t* data, size_t size, size_t first, size_t stride, const void* needle, size_t len,
+                                std::vector<size_t>& hits)
+{
+    if (!data || !needle || len == 0 || size < first + len)
+    {
+        return;
+    }
+
+    if (stride <= 1)
+    {
+        FindAll(data, size, needle, len, hits);
+        return;
+    }
+
+    // value sized needles compare whole elements at the stride
+    CGPValueType element = CGPValueType::UByte;
+
+    switch (len)
+    {
+        case 1: element = CGPValueType::UByte; break;
+        case 2: element = CGPValueType::UShort; break;
+        case 4: element = CGPValueType::UInt; break;
+        case 8: element = CGPValueType::ULong; break;
+        default:
+        {
+            size_t from = hits.size();
+            FindAll(data + first, size - first, needle, len, hits);
+
+            size_t kept = from;
+
+            for (size_t i = from; i < hits.size(); ++i)
+            {
+                if (hits[i] % stride == 0)
+                {
+                    hits[kept++] = hits[i] + first;
+                }
+            }
+
+            hits.resize(kept);
+            return;
+        }
+    }
+
+    ValueScanner(element, CGPCompare::Equal)(data, size, first, stride, static_cast<const uint8_t*>(needle), nullptr, hits);
+}
+
+size_t CGPScanKernel::Mismatch(const uint8_t* a, const uint8_t* b, size_t size, size_t from)
+{
+    static const MismatchFn mismatch = SelectMismatch();
+
+    if (from >= size)
+    {
+        return size;
+    }
+
+    return mismatch(a, b, size, from);
+}
+
+const char* CGPScanKernel::Name()
+{
+    const char* name = nullptr;
+    ActiveKernel(&name);
+    return name;
+}
+
+CGPValueScanFn CGPScanKernel::ValueScanner(CGPValueType type, CGPCompare predicate)
+{
+    CGPValueScanFn scan = nullptr;
+    CGPValueTestFn test = nullptr;
+
+    SelectValueKernel(type, predicate, &scan, &test);
+    return scan;
+}
+
+CGPValueTestFn CGPScanKernel::ValueTester(CGPValueType type, CGPCompare predicate)
+{
+    CGPValueScanFn scan = nullptr;
+    CGPValueTestFn test = nullptr;
+
+    SelectValueKernel(type, predicate, &scan, &test);
+    return test;
+}
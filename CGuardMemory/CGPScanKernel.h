@@ -0,0 +1,88 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPScanKernel.h * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPScanKernel_h
+#define CGPScanKernel_h
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class CGPCompare {
+    Equal,
+    NotEqual,
+    Less,           // typed scans only from here on
+    Greater,
+    Between,        // value <= x <= bound
+    EqualEpsilon,   // value - bound <= x <= value + bound
+};
+
+/* Value types of the CGP_Type_* widths */
+enum class CGPValueType {
+    SByte,
+    UByte,
+    SShort,
+    UShort,
+    SInt,
+    UInt,
+    SLong,
+    ULong,
+    Float,
+    Double,
+};
+
+static inline size_t CGPValueSize(CGPValueType type)
+{
+    switch (type)
+    {
+        case CGPValueType::SByte:
+        case CGPValueType::UByte:
+            return 1;
+        case CGPValueType::SShort:
+        case CGPValueType::UShort:
+            return 2;
+        case CGPValueType::SInt:
+        case CGPValueType::UInt:
+        case CGPValueType::Float:
+            return 4;
+        default:
+            return 8;
+    }
+}
+
+/* (data, size, first, stride, value, bound, hits) appends every offset first + k * stride whose value matches */
+typedef void (*CGPValueScanFn)(const uint8_t*, size_t, size_t, size_t, const uint8_t*, const uint8_t*, std::vector<size_t>&);
+/* (data, value, bound) tests one value */
+typedef bool (*CGPValueTestFn)(const uint8_t*, const uint8_t*, const uint8_t*);
+
+/*
+ * Vectorized Byte Matcher
+ * 1/2/4/8-byte needles compare 16 (SSE2/NEON) or 32 (AVX2) candidate offsets
+ * per step, longer needles are filtered on their first and last byte and
+ * verified with memcmp. The instruction set is picked once at runtime.
+ */
+class CGPScanKernel {
+public:
+    /* Appends every offset in [0, size - len] where needle matches */
+    static void FindAll(const uint8_t* data, size_t size, const void* needle, size_t len, std::vector<size_t>& hits);
+    /* Same, only at offsets first + k * stride, stride is a power of two */
+    static void FindAligned(const uint8_t* data, size_t size, size_t first, size_t stride, const void* needle, size_t len,
+                            std::vector<size_t>& hits);
+
+    /* First offset in [from, size) where a and b differ, size when they match */
+    static size_t Mismatch(const uint8_t* a, const uint8_t* b, size_t size, size_t from = 0);
+
+    /* Typed kernels, one instantiation per (type, predicate), picked once per scan */
+    static CGPValueScanFn ValueScanner(CGPValueType type, CGPCompare predicate);
+    static CGPValueTestFn ValueTester(CGPValueType type, CGPCompare predicate);
+
+    /* "avx2", "sse2", "neon" or "scalar" */
+    static const char* Name();
+};
+
+#endif /* CGPScanKernel_h */
@@ -0,0 +1,192 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPSigCache.cpp * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPSigCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+/*
+ * File layout, host byte order
+ *   uint32 magic, uint32 version, uint8 key[16], uint32 count
+ *   count * { uint32 length, char signature[length], uint64 offset }
+ */
+
+typedef std::unique_ptr<FILE, int (*)(FILE*)> CacheFile;
+
+template <typename T>
+static inline bool ReadValue(FILE* file, T* value)
+{
+    return fread(value, sizeof(T), 1, file) == 1;
+}
+
+template <typename T>
+static inline bool WriteValue(FILE* file, const T& value)
+{
+    return fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+#pragma mark - CGPSigCache Implementation -
+
+CGPSigCache::CGPSigCache(const std::string& path, const uint8_t key[CGP_SigCache_Key_Size])
+    : path_(path), dirty_(false)
+{
+    memcpy(key_, key, sizeof(key_));
+}
+
+bool CGPSigCache::Load()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    entries_.clear();
+    dirty_ = false;
+
+    CacheFile file(fopen(path_.c_str(), "rb"), fclose);
+
+    if (!file)
+    {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint8_t key[CGP_SigCache_Key_Size];
+    uint32_t count = 0;
+
+    if (!ReadValue(file.get(), &magic) || !ReadValue(file.get(), &version) ||
+        fread(key, sizeof(key), 1, file.get()) != 1 || !ReadValue(file.get(), &count))
+    {
+        return false;
+    }
+
+    if (magic != CGP_SigCache_Magic || version != CGP_SigCache_Version || memcmp(key, key_, sizeof(key)) != 0)
+    { // another binary or format, rebuilt on the next Save
+        return false;
+    }
+
+    std::string signature;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t length = 0;
+        uint64_t offset = 0;
+
+        if (!ReadValue(file.get(), &length) || length > (1u << 16))
+        {
+            entries_.clear();
+            return false;
+        }
+
+        signature.resize(length);
+
+        if ((length && fread(&signature[0], length, 1, file.get()) != 1) || !ReadValue(file.get(), &offset))
+        { // truncated file
+            entries_.clear();
+            return false;
+        }
+
+        entries_[signature] = offset;
+    }
+
+    return true;
+}
+
+bool CGPSigCache::Save() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::string temporary = path_ + ".tmp";
+
+    {
+        CacheFile file(fopen(temporary.c_str(), "wb"), fclose);
+
+        if (!file)
+        {
+            return false;
+        }
+
+        bool ok = WriteValue(file.get(), static_cast<uint32_t>(CGP_SigCache_Magic)) &&
+                  WriteValue(file.get(), static_cast<uint32_t>(CGP_SigCache_Version)) &&
+                  fwrite(key_, sizeof(key_), 1, file.get()) == 1 &&
+                  WriteValue(file.get(), static_cast<uint32_t>(entries_.size()));
+
+        for (auto it = entries_.begin(); ok && it != entries_.end(); ++it)
+        {
+            ok = WriteValue(file.get(), static_cast<uint32_t>(it->first.size())) &&
+                 (it->first.empty() || fwrite(it->first.data(), it->first.size(), 1, file.get()) == 1) &&
+                 WriteValue(file.get(), it->second);
+        }
+
+        if (!ok || fflush(file.get()) != 0)
+        {
+            file.reset();
+            remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    if (rename(temporary.c_str(), path_.c_str()) != 0)
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+
+    dirty_ = false;
+    return true;
+}
+
+bool CGPSigCache::Lookup(const std::string& signature, uint64_t* offset) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = entries_.find(signature);
+
+    if (it == entries_.end())
+    {
+        return false;
+    }
+
+    *offset = it->second;
+    return true;
+}
+
+void CGPSigCache::Store(const std::string& signature, uint64_t offset)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto result = entries_.emplace(signature, offset);
+
+    if (result.second || result.first->second != offset)
+    {
+        result.first->second = offset;
+        dirty_ = true;
+    }
+}
+
+void CGPSigCache::Erase(const std::string& signature)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (entries_.erase(signature) != 0)
+    {
+        dirty_ = true;
+    }
+}
+
+size_t CGPSigCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+bool CGPSigCache::IsDirty() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dirty_;
+}
@@ -0,0 +1,54 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPSigCache.h * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPSigCache_h
+#define CGPSigCache_h
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define CGP_SigCache_Magic 0x43475053   // "CGPS"
+#define CGP_SigCache_Version 1
+#define CGP_SigCache_Key_Size 16
+
+/*
+ * Signature Cache
+ * Maps a signature to the offset of its match from the image base. The
+ * file belongs to one binary identity (LC_UUID, or a segment hash when
+ * the image has none), a file written for another key loads empty.
+ * Callers re-check the pattern at a cached offset before trusting it.
+ */
+class CGPSigCache {
+public:
+    CGPSigCache(const std::string& path, const uint8_t key[CGP_SigCache_Key_Size]);
+
+    /* false when the file is missing, unreadable or for another binary, the cache then starts empty */
+    bool Load();
+    /* Writes a temporary file next to path and renames it over */
+    bool Save() const;
+
+    bool Lookup(const std::string& signature, uint64_t* offset) const;
+    void Store(const std::string& signature, uint64_t offset);
+    void Erase(const std::string& signature);
+
+    size_t Size() const;
+    bool IsDirty() const;
+
+private:
+    std::string path_;
+    uint8_t key_[CGP_SigCache_Key_Size];
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, uint64_t> entries_;
+    mutable bool dirty_;
+};
+
+#endif /* CGPSigCache_h */
@@ -0,0 +1,281 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPSnapshot.cpp * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPSnapshot.h"
+#include "CGPCompress.h"
+
+#include <cstring>
+#include <type_traits>
+
+static inline bool IsZeroPage(const uint8_t* data, size_t size)
+{
+    uint64_t bits = 0;
+
+    for (size_t i = 0; i < size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        bits |= word;
+    }
+
+    return bits == 0;
+}
+
+/* Integer deltas wrap like the target's own arithmetic would */
+template <typename T>
+static inline T AddDelta(T value, T delta)
+{
+    if constexpr (std::is_integral<T>::value)
+    {
+        typedef typename std::make_unsigned<T>::type U;
+        return static_cast<T>(static_cast<U>(value) + static_cast<U>(delta));
+    }
+    else
+    {
+        return value + delta;
+    }
+}
+
+/* Changed/Unchanged compare bits, so a NaN that stays put is unchanged */
+template <typename T, CGPSnapshotCompare M>
+static inline bool SnapshotMatch(const uint8_t* now, const uint8_t* old, T delta)
+{
+    T a;
+    T b;
+    memcpy(&a, now, sizeof(T));
+    memcpy(&b, old, sizeof(T));
+
+    switch (M)
+    {
+        case CGPSnapshotCompare::Changed:
+            return memcmp(now, old, sizeof(T)) != 0;
+        case CGPSnapshotCompare::Unchanged:
+            return memcmp(now, old, sizeof(T)) == 0;
+        case CGPSnapshotCompare::Increased:
+            return a > b;
+        case CGPSnapshotCompare::Decreased:
+            return a < b;
+        case CGPSnapshotCompare::IncreasedBy:
+            return a == AddDelta(b, delta);
+        case CGPSnapshotCompare::DecreasedBy:
+            return b == AddDelta(a, delta);
+    }
+
+    return false;
+}
+
+template <typename T>
+static inline T LoadDelta(const uint8_t* delta)
+{
+    T value = 0;
+
+    if (delta)
+    {
+        memcpy(&value, delta, sizeof(T));
+    }
+
+    return value;
+}
+
+template <typename T, CGPSnapshotCompare M>
+static void ComparePage(const uint8_t* now, const uint8_t* old, size_t size, size_t stride, const uint8_t* delta,
+                        std::vector<size_t>& hits)
+{
+    constexpr bool byDelta = (M == CGPSnapshotCompare::IncreasedBy || M == CGPSnapshotCompare::DecreasedBy);
+
+    // most pages do not move between refines
+    if (!byDelta && memcmp(now, old, size) == 0)
+    {
+        if (M == CGPSnapshotCompare::Unchanged)
+        {
+            for (size_t i = 0; i + sizeof(T) <= size; i += stride)
+            {
+                hits.push_back(i);
+            }
+        }
+
+        return;
+    }
+
+    T value = LoadDelta<T>(delta);
+
+    for (size_t i = 0; i + sizeof(T) <= size; i += stride)
+    {
+        if (SnapshotMatch<T, M>(now + i, old + i, value))
+        {
+            hits.push_back(i);
+        }
+    }
+}
+
+template <typename T, CGPSnapshotCompare M>
+static bool CompareValue(const uint8_t* now, const uint8_t* old, const uint8_t* delta)
+{
+    return SnapshotMatch<T, M>(now, old, LoadDelta<T>(delta));
+}
+
+template <typename T>
+static void SelectMode(CGPSnapshotCompare mode, CGPPageCompareFn* page, CGPValueCompareFn* value)
+{
+    switch (mode)
+    {
+        case CGPSnapshotCompare::Changed:
+            *page = ComparePage<T, CGPSnapshotCompare::Changed>;
+            *value = CompareValue<T, CGPSnapshotCompare::Changed>;
+            break;
+        case CGPSnapshotCompare::Unchanged:
+            *page = ComparePage<T, CGPSnapshotCompare::Unchanged>;
+            *value = CompareValue<T, CGPSnapshotCompare::Unchanged>;
+            break;
+        case CGPSnapshotCompare::Increased:
+            *page = ComparePage<T, CGPSnapshotCompare::Increased>;
+            *value = CompareValue<T, CGPSnapshotCompare::Increased>;
+            break;
+        case CGPSnapshotCompare::Decreased:
+            *page = ComparePage<T, CGPSnapshotCompare::Decreased>;
+            *value = CompareValue<T, CGPSnapshotCompare::Decreased>;
+            break;
+        case CGPSnapshotCompare::IncreasedBy:
+            *page = ComparePage<T, CGPSnapshotCompare::IncreasedBy>;
+            *value = CompareValue<T, CGPSnapshotCompare::IncreasedBy>;
+            break;
+        case CGPSnapshotCompare::DecreasedBy:
+            *page = ComparePage<T, CGPSnapshotCompare::DecreasedBy>;
+            *value = CompareValue<T, CGPSnapshotCompare::DecreasedBy>;
+            break;
+    }
+}
+
+static void SelectComparer(CGPValueType type, CGPSnapshotCompare mode, CGPPageCompareFn* page, CGPValueCompareFn* value)
+{
+    switch (type)
+    {
+        case CGPValueType::SByte:  SelectMode<int8_t>(mode, page, value); break;
+        case CGPValueType::UByte:  SelectMode<uint8_t>(mode, page, value); break;
+        case CGPValueType::SShort: SelectMode<int16_t>(mode, page, value); break;
+        case CGPValueType::UShort: SelectMode<uint16_t>(mode, page, value); break;
+        case CGPValueType::SInt:   SelectMode<int32_t>(mode, page, value); break;
+        case CGPValueType::UInt:   SelectMode<uint32_t>(mode, page, value); break;
+        case CGPValueType::SLong:  SelectMode<int64_t>(mode, page, value); break;
+        case CGPValueType::ULong:  SelectMode<uint64_t>(mode, page, value); break;
+        case CGPValueType::Float:  SelectMode<float>(mode, page, value); break;
+        case CGPValueType::Double: SelectMode<double>(mode, page, value); break;
+    }
+}
+
+#pragma mark - CGPSnapshot Implementation -
+
+CGPSnapshot::CGPSnapshot(size_t pageSize)
+    : pageSize_(pageSize)
+{
+}
+
+void CGPSnapshot::Clear()
+{
+    pages_.clear();
+    blob_.clear();
+}
+
+void CGPSnapshot::Reserve(size_t pages, size_t dataSize)
+{
+    pages_.reserve(pages);
+    blob_.reserve(dataSize);
+}
+
+void CGPSnapshot::AddPage(uint64_t address, const uint8_t* data)
+{
+    SnapshotPage page = { address, blob_.size(), 0, CGP_Page_Zero };
+
+    if (IsZeroPage(data, pageSize_))
+    {
+        pages_.push_back(page);
+        return;
+    }
+
+    // compress in place at the end of the blob, anything not smaller than the page is stored raw
+    blob_.resize(page.data_offset + pageSize_);
+
+    size_t size = CGPCompress(data, pageSize_, blob_.data() + page.data_offset, pageSize_ - 1);
+
+    if (size == 0)
+    {
+        memcpy(blob_.data() + page.data_offset, data, pageSize_);
+        size = pageSize_;
+        page.encoding = CGP_Page_Raw;
+    }
+    else
+    {
+        page.encoding = CGP_Page_LZ;
+    }
+
+    blob_.resize(page.data_offset + size);
+
+    page.data_size = static_cast<uint32_t>(size);
+    pages_.push_back(page);
+}
+
+void CGPSnapshot::AppendSnapshot(const CGPSnapshot& other)
+{
+    uint64_t shift = blob_.size();
+
+    blob_.insert(blob_.end(), other.blob_.begin(), other.blob_.end());
+
+    for (SnapshotPage page : other.pages_)
+    {
+        page.data_offset += shift;
+        pages_.push_back(page);
+    }
+}
+
+bool CGPSnapshot::LoadPage(size_t index, uint8_t* out) const
+{
+    if (index >= pages_.size())
+    {
+        return false;
+    }
+
+    const SnapshotPage& page = pages_[index];
+    const uint8_t* data = blob_.data() + page.data_offset;
+
+    switch (page.encoding)
+    {
+        case CGP_Page_Zero:
+            memset(out, 0, pageSize_);
+            return true;
+        case CGP_Page_LZ:
+            return CGPDecompress(data, page.data_size, out, pageSize_);
+        case CGP_Page_Raw:
+            memcpy(out, data, pageSize_);
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t CGPSnapshot::Bytes() const
+{
+    return pages_.capacity() * sizeof(SnapshotPage) + blob_.capacity();
+}
+
+CGPPageCompareFn CGPSnapshot::PageComparer(CGPValueType type, CGPSnapshotCompare mode)
+{
+    CGPPageCompareFn page = nullptr;
+    CGPValueCompareFn value = nullptr;
+
+    SelectComparer(type, mode, &page, &value);
+    return page;
+}
+
+CGPValueCompareFn CGPSnapshot::ValueComparer(CGPValueType type, CGPSnapshotCompare mode)
+{
+    CGPPageCompareFn page = nullptr;
+    CGPValueCompareFn value = nullptr;
+
+    SelectComparer(type, mode, &page, &value);
+    return value;
+}
@@ -0,0 +1,82 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPSnapshot.h * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPSnapshot_h
+#define CGPSnapshot_h
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CGPScanKernel.h"
+
+/* SnapshotPage encodings */
+#define CGP_Page_Zero 0 // no data stored
+#define CGP_Page_LZ 1   // CGPCompress block
+#define CGP_Page_Raw 2  // did not compress
+
+enum class CGPSnapshotCompare {
+    Changed,
+    Unchanged,
+    Increased,
+    Decreased,
+    IncreasedBy,
+    DecreasedBy,
+};
+
+typedef struct _snapshot_page {
+    uint64_t address;
+    uint64_t data_offset;   // in the snapshot blob
+    uint32_t data_size;
+    uint8_t encoding;
+} SnapshotPage;
+
+/* (now, old, size, stride, delta, hits) appends the offsets of every matching value in a page, values crossing its end are skipped */
+typedef void (*CGPPageCompareFn)(const uint8_t*, const uint8_t*, size_t, size_t, const uint8_t*, std::vector<size_t>&);
+/* (now, old, delta) compares a single value */
+typedef bool (*CGPValueCompareFn)(const uint8_t*, const uint8_t*, const uint8_t*);
+
+/*
+ * Compressed Page Snapshot
+ * Pages are added in ascending address order, zero pages cost only their
+ * table entry, everything else is stored as an LZ block or raw when that
+ * would not be smaller.
+ */
+class CGPSnapshot {
+public:
+    explicit CGPSnapshot(size_t pageSize);
+
+    void Clear();
+    void Reserve(size_t pages, size_t dataSize);
+
+    /* address is page aligned and above every page already stored */
+    void AddPage(uint64_t address, const uint8_t* data);
+    /* other starts above every page already stored */
+    void AppendSnapshot(const CGPSnapshot& other);
+
+    /* out holds PageSize() bytes */
+    bool LoadPage(size_t index, uint8_t* out) const;
+
+    const std::vector<SnapshotPage>& Pages() const { return pages_; }
+    size_t PageSize() const { return pageSize_; }
+    size_t DataSize() const { return blob_.size(); }
+
+    /* Table plus compressed data */
+    size_t Bytes() const;
+
+    /* Comparators picked once per refine, the (type, mode) switch stays out of the loops */
+    static CGPPageCompareFn PageComparer(CGPValueType type, CGPSnapshotCompare mode);
+    static CGPValueCompareFn ValueComparer(CGPValueType type, CGPSnapshotCompare mode);
+
+private:
+    size_t pageSize_;
+    std::vector<SnapshotPage> pages_;
+    std::vector<uint8_t> blob_;
+};
+
+#endif /* CGPSnapshot_h */
@@ -0,0 +1,177 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPThreadPool.cpp * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPThreadPool.h"
+
+#include <algorithm>
+
+#pragma mark - CGPThreadPool Implementation -
+
+CGPThreadPool::CGPThreadPool(size_t threads)
+    : job_(nullptr), generation_(0), active_(0), stop_(false)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    lanes_ = std::make_unique<Lane[]>(threads);
+
+    for (size_t i = 1; i < threads; ++i)
+    {
+        threads_.emplace_back(&CGPThreadPool::WorkerLoop, this, i);
+    }
+}
+
+CGPThreadPool::~CGPThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    wake_.notify_all();
+
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void CGPThreadPool::Run(size_t tasks, const std::function<void(size_t task, size_t worker)>& fn)
+{
+    if (tasks == 0)
+    {
+        return;
+    }
+
+    if (threads_.empty() || tasks == 1)
+    {
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            fn(i, 0);
+        }
+
+        return;
+    }
+
+    size_t lanes = Size();
+
+    for (size_t i = 0; i < lanes; ++i)
+    {
+        std::lock_guard<std::mutex> lock(lanes_[i].lock);
+        lanes_[i].begin = tasks * i / lanes;
+        lanes_[i].end = tasks * (i + 1) / lanes;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &fn;
+        active_ = threads_.size();
+        ++generation_;
+    }
+
+    wake_.notify_all();
+
+    Work(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return active_ == 0; });
+    job_ = nullptr;
+}
+
+void CGPThreadPool::WorkerLoop(size_t worker)
+{
+    uint64_t seen = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+
+            if (stop_)
+            {
+                return;
+            }
+
+            seen = generation_;
+        }
+
+        Work(worker);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (--active_ == 0)
+        {
+            done_.notify_all();
+        }
+    }
+}
+
+void CGPThreadPool::Work(size_t worker)
+{
+    size_t task = 0;
+
+    while (Pop(worker, &task) || Steal(worker, &task))
+    {
+        (*job_)(task, worker);
+    }
+}
+
+bool CGPThreadPool::Pop(size_t worker, size_t* task)
+{
+    Lane& lane = lanes_[worker];
+    std::lock_guard<std::mutex> lock(lane.lock);
+
+    if (lane.begin >= lane.end)
+    {
+        return false;
+    }
+
+    *task = lane.begin++;
+    return true;
+}
+
+bool CGPThreadPool::Steal(size_t worker, size_t* task)
+{
+    size_t lanes = Size();
+
+    for (size_t i = 1; i < lanes; ++i)
+    {
+        Lane& victim = lanes_[(worker + i) % lanes];
+        size_t begin = 0;
+        size_t end = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(victim.lock);
+
+            if (victim.begin >= victim.end)
+            {
+                continue;
+            }
+
+            // take the back half, the victim keeps working from the front
+            size_t take = (victim.end - victim.begin + 1) / 2;
+            begin = victim.end - take;
+            end = victim.end;
+            victim.end = begin;
+        }
+
+        *task = begin;
+
+        Lane& own = lanes_[worker];
+        std::lock_guard<std::mutex> lock(own.lock);
+        own.begin = begin + 1;
+        own.end = end;
+
+        return true;
+    }
+
+    return false;
+}
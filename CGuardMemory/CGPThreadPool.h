@@ -0,0 +1,66 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPThreadPool.h * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPThreadPool_h
+#define CGPThreadPool_h
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Work Stealing Thread Pool
+ * Run() splits [0, tasks) into one index range per lane. A lane pops from
+ * the front of its own range and, once empty, steals the back half of
+ * another lane's range. The calling thread works as lane 0.
+ * Run() is not reentrant, one caller at a time.
+ */
+class CGPThreadPool {
+public:
+    /* threads = 0 uses every hardware thread */
+    explicit CGPThreadPool(size_t threads = 0);
+    ~CGPThreadPool();
+
+    CGPThreadPool(const CGPThreadPool&) = delete;
+    CGPThreadPool& operator=(const CGPThreadPool&) = delete;
+
+    /* Lanes including the caller, fn's worker argument is below this */
+    size_t Size() const { return threads_.size() + 1; }
+
+    void Run(size_t tasks, const std::function<void(size_t task, size_t worker)>& fn);
+
+private:
+    struct Lane {
+        std::mutex lock;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    void WorkerLoop(size_t worker);
+    void Work(size_t worker);
+    bool Pop(size_t worker, size_t* task);
+    bool Steal(size_t worker, size_t* task);
+
+    std::vector<std::thread> threads_;
+    std::unique_ptr<Lane[]> lanes_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(size_t, size_t)>* job_;
+    uint64_t generation_;
+    size_t active_;
+    bool stop_;
+};
+
+#endif /* CGPThreadPool_h */
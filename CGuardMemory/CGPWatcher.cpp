@@ -0,0 +1,254 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPWatcher.cpp  * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#include "CGPWatcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "CGPScanKernel.h"
+
+static size_t RingCapacity(size_t size)
+{
+    size_t capacity = 1;
+
+    while (capacity < size)
+    {
+        capacity <<= 1;
+    }
+
+    return capacity;
+}
+
+#pragma mark - CGPWatcher Implementation -
+
+CGPWatcher::CGPWatcher(CGPMemoryBackend& backend, size_t ringSize)
+    : backend_(backend), pending_(false), nextId_(1), ring_(new WatchChange[RingCapacity(ringSize)]),
+      ringMask_(RingCapacity(ringSize) - 1), ringHead_(0), ringTail_(0), dropped_(0), reads_(0), stop_(false)
+{
+    thread_ = std::thread(&CGPWatcher::ThreadLoop, this);
+}
+
+CGPWatcher::~CGPWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    wake_.notify_one();
+    thread_.join();
+}
+
+uint32_t CGPWatcher::Add(uint64_t address, size_t size, size_t width, uint32_t minIntervalMs, uint32_t maxIntervalMs)
+{
+    WatchRange range;
+    range.address = address;
+    range.width = width;
+    range.min_interval = std::chrono::milliseconds(minIntervalMs);
+    range.max_interval = std::chrono::milliseconds(std::max(minIntervalMs, maxIntervalMs));
+    range.interval = range.min_interval;
+    range.due = Clock::now();
+    range.primed = false;
+    range.previous.resize(size);
+    range.current.resize(size);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    range.id = nextId_++;
+    uint32_t id = range.id;
+
+    adding_.push_back(std::move(range));
+    pending_ = true;
+    wake_.notify_one();
+
+    return id;
+}
+
+void CGPWatcher::Remove(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    removing_.push_back(id);
+    pending_ = true;
+    wake_.notify_one();
+}
+
+void CGPWatcher::SetCallback(WatchCallback callback)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    pendingCallback_ = std::make_unique<WatchCallback>(std::move(callback));
+    pending_ = true;
+    wake_.notify_one();
+}
+
+size_t CGPWatcher::Poll(WatchChange* out, size_t max)
+{
+    size_t tail = ringTail_.load(std::memory_order_relaxed);
+    size_t head = ringHead_.load(std::memory_order_acquire);
+    size_t count = std::min(max, head - tail);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = ring_[(tail + i) & ringMask_];
+    }
+
+    ringTail_.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+/* Called with mutex_ held */
+void CGPWatcher::Apply()
+{
+    for (auto& range : adding_)
+    {
+        ranges_.push_back(std::move(range));
+    }
+
+    adding_.clear();
+
+    if (!removing_.empty())
+    {
+        ranges_.erase(std::remove_if(ranges_.begin(), ranges_.end(), [this](const WatchRange& range)
+        {
+            return std::find(removing_.begin(), removing_.end(), range.id) != removing_.end();
+        }), ranges_.end());
+
+        removing_.clear();
+    }
+
+    if (pendingCallback_)
+    {
+        callback_ = std::move(*pendingCallback_);
+        pendingCallback_.reset();
+    }
+
+    pending_ = false;
+}
+
+void CGPWatcher::Pass(Clock::time_point now)
+{
+    due_.clear();
+    ops_.clear();
+
+    for (size_t i = 0; i < ranges_.size(); ++i)
+    {
+        WatchRange& range = ranges_[i];
+
+        if (range.due <= now)
+        {
+            due_.push_back(i);
+            ops_.push_back({ range.address, range.current.data(), range.current.size(), 0 });
+        }
+    }
+
+    if (due_.empty())
+    {
+        return;
+    }
+
+    backend_.ReadBatch(ops_.data(), ops_.size());
+    reads_ += ops_.size();
+
+    changes_.clear();
+
+    for (size_t i = 0; i < due_.size(); ++i)
+    {
+        WatchRange& range = ranges_[due_[i]];
+        bool changed = false;
+
+        if (ops_[i].transferred != ops_[i].len)
+        { // unreadable for now, keep the last contents and back off
+            range.interval = std::min(range.interval * 2, range.max_interval);
+            range.due = now + range.interval;
+            continue;
+        }
+
+        if (range.primed)
+        {
+            const uint8_t* previous = range.previous.data();
+            const uint8_t* current = range.current.data();
+            size_t size = range.current.size();
+
+            for (size_t at = CGPScanKernel::Mismatch(current, previous, size); at < size;
+                 at = CGPScanKernel::Mismatch(current, previous, size, at))
+            {
+                size_t element = at - at % range.width;
+                WatchChange change = { range.address + element, 0, 0, range.id, static_cast<uint32_t>(range.width) };
+
+                memcpy(&change.old_bits, previous + element, range.width);
+                memcpy(&change.new_bits, current + element, range.width);
+                changes_.push_back(change);
+
+                at = element + range.width;
+            }
+
+            changed = !changes_.empty() && changes_.back().watch == range.id;
+        }
+
+        range.previous.swap(range.current);
+        range.primed = true;
+
+        range.interval = changed ? range.min_interval : std::min(range.interval * 2, range.max_interval);
+        range.due = now + range.interval;
+    }
+
+    Publish();
+}
+
+void CGPWatcher::Publish()
+{
+    if (changes_.empty())
+    {
+        return;
+    }
+
+    if (callback_)
+    {
+        callback_(changes_.data(), changes_.size());
+        return;
+    }
+
+    size_t head = ringHead_.load(std::memory_order_relaxed);
+    size_t tail = ringTail_.load(std::memory_order_acquire);
+    size_t room = (ringMask_ + 1) - (head - tail);
+    size_t count = std::min(room, changes_.size());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        ring_[(head + i) & ringMask_] = changes_[i];
+    }
+
+    ringHead_.store(head + count, std::memory_order_release);
+    dropped_ += changes_.size() - count;
+}
+
+void CGPWatcher::ThreadLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stop_)
+    {
+        Apply();
+        lock.unlock();
+
+        Clock::time_point now = Clock::now();
+        Pass(now);
+
+        Clock::time_point wake = now + std::chrono::milliseconds(CGP_Watch_Idle_Ms);
+
+        for (const auto& range : ranges_)
+        {
+            wake = std::min(wake, range.due);
+        }
+
+        lock.lock();
+        wake_.wait_until(lock, wake, [this] { return stop_ || pending_; });
+    }
+}
@@ -0,0 +1,121 @@
+/* * * * * * * * * * * * * * * * * * *
+ * * CGPWatcher.h  * * * * * * * * * *
+ * * CGuardProbe (And More!) * * * * *
+ * * * * * * * * * * * * * * * * * * *
+ * * Made by OPSphystech420  * * * * *
+ * * Contributor ZarakiDev 2024 (c)  *
+ * * * * * * * * * * * * * * * * * * */
+
+#ifndef CGPWatcher_h
+#define CGPWatcher_h
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CGPBackend.h"
+
+/* Default change ring, entries, a power of two */
+#define CGP_Watch_Ring_Size 65536
+
+/* Longest sleep of the watch thread while nothing is due */
+#define CGP_Watch_Idle_Ms 50
+
+typedef struct _watch_change {
+    uint64_t address;
+    uint64_t old_bits;  // low width bytes
+    uint64_t new_bits;
+    uint32_t watch;     // id from Add
+    uint32_t width;
+} WatchChange;
+
+/* Runs on the watch thread with every change of one pass */
+typedef std::function<void(const WatchChange* changes, size_t count)> WatchCallback;
+
+/*
+ * Watch List Monitor
+ * A background thread re-reads the due ranges in one ReadBatch and diffs
+ * them against the previous read with CGPScanKernel::Mismatch. A range that
+ * changed is polled again at its minimum interval, every quiet pass doubles
+ * its interval up to the maximum, so idle ranges are barely read.
+ * Changes go to the callback when one is set, otherwise to a ring that
+ * Poll() drains; a full ring drops the newest changes.
+ */
+class CGPWatcher {
+public:
+    /* backend outlives the watcher, ringSize is rounded up to a power of two */
+    explicit CGPWatcher(CGPMemoryBackend& backend, size_t ringSize = CGP_Watch_Ring_Size);
+    ~CGPWatcher();
+
+    CGPWatcher(const CGPWatcher&) = delete;
+    CGPWatcher& operator=(const CGPWatcher&) = delete;
+
+    /* width is 1, 2, 4 or 8 and divides size, returns the watch id, never 0 */
+    uint32_t Add(uint64_t address, size_t size, size_t width, uint32_t minIntervalMs, uint32_t maxIntervalMs);
+    void Remove(uint32_t id);
+    void SetCallback(WatchCallback callback);
+
+    /* Single consumer, copies up to max pending changes to out */
+    size_t Poll(WatchChange* out, size_t max);
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t Reads() const { return reads_.load(std::memory_order_relaxed); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    typedef struct _watch_range {
+        uint32_t id;
+        uint64_t address;
+        size_t width;
+        Clock::duration min_interval;
+        Clock::duration max_interval;
+        Clock::duration interval;
+        Clock::time_point due;
+        bool primed;                    // previous holds a full read
+        std::vector<uint8_t> previous;
+        std::vector<uint8_t> current;   // read target, swapped with previous after the diff
+    } WatchRange;
+
+    void Apply();
+    void Pass(Clock::time_point now);
+    void Publish();
+    void ThreadLoop();
+
+    CGPMemoryBackend& backend_;
+
+    // owned by the watch thread
+    std::vector<WatchRange> ranges_;
+    std::vector<size_t> due_;
+    std::vector<RemoteIO> ops_;
+    std::vector<WatchChange> changes_;
+    WatchCallback callback_;
+
+    // handed over under mutex_
+    std::vector<WatchRange> adding_;
+    std::vector<uint32_t> removing_;
+    std::unique_ptr<WatchCallback> pendingCallback_;
+    bool pending_;
+    uint32_t nextId_;
+
+    // single producer, single consumer
+    std::unique_ptr<WatchChange[]> ring_;
+    size_t ringMask_;
+    std::atomic<size_t> ringHead_;      // next write, watch thread only
+    std::atomic<size_t> ringTail_;      // next read, Poll only
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> reads_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_;
+    std::thread thread_;
+};
+
+#endif /* CGPWatcher_h */